@@ -0,0 +1,192 @@
+# Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+# All rights reserved.
+# 
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+# 
+# * Redistributions of source code must retain the above copyright notice, this
+#   list of conditions and the following disclaimer.
+# 
+# * Redistributions in binary form must reproduce the above copyright notice,
+#   this list of conditions and the following disclaimer in the documentation
+#   and/or other materials provided with the distribution.
+# 
+# * Neither the name of the copyright holder nor the names of its
+#   contributors may be used to endorse or promote products derived from
+#   this software without specific prior written permission.
+# 
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# Generation of meter applications from a manifest
+#
+# Each non-empty line of a manifest describes a single meter application:
+#
+#   <module> [<module>...] [march=<arch>] [lto=<on|off>] [name=<target>]
+#
+# For example:
+#
+#   thermal_msr power_msr frequency_sysfs march=native
+#
+# The target name defaults to "meter_" followed by the modules joined with
+# "+", e.g. "meter_thermal_msr+power_msr+frequency_sysfs". Modules of the
+# apps are prefixed with "apps::", e.g. "apps::membw", which is omitted from
+# the default target name. Everything after a "#" is a comment. Per-line
+# options override EXOT_MANIFEST_MARCH and EXOT_MANIFEST_LTO.
+
+set(EXOT_METER_TEMPLATE "${CMAKE_CURRENT_LIST_DIR}/meter.cpp.in")
+
+# Honour INTERPROCEDURAL_OPTIMIZATION; recorded with the functions below
+if(POLICY CMP0069)
+  cmake_policy(SET CMP0069 NEW)
+endif()
+
+# Maps a module name to its header, to its type qualified relative to the
+# exot namespace, and to the preprocessor condition under which it is
+# available. Modules of the apps are given with an "apps::" prefix, e.g.
+# "apps::membw".
+function(exot_meter_module module out_header out_qualified out_guard)
+  set(_guard "")
+  set(_qualified "modules::${module}")
+  if(module MATCHES "^apps::(cache_er|frequency_sysfs|membw|perf_counters|thermal_sysfs|utilisation_procfs)$")
+    set(_header "exot/apps/modules/${CMAKE_MATCH_1}.h")
+    set(_qualified "apps::modules::${CMAKE_MATCH_1}")
+  elseif(module MATCHES "^apps::(thermal_msr|power_msr)$")
+    set(_header "exot/apps/modules/${CMAKE_MATCH_1}.h")
+    set(_qualified "apps::modules::${CMAKE_MATCH_1}")
+    set(_guard "defined(__x86_64__)")
+  elseif(module MATCHES "^(thermal_msr|power_msr)$")
+    set(_header "exot/meters/${module}.h")
+    set(_guard "defined(__x86_64__)")
+  elseif(module MATCHES "^(rdseed_status|rdseed_timing)$")
+    set(_header "exot/meters/rdseed.h")
+    set(_guard "defined(__x86_64__)")
+  elseif(module MATCHES "^(cache_fr|cache_ff|cache_fp)$")
+    set(_header "exot/meters/cache.h")
+    set(_guard "(defined(__x86_64__) || defined(__aarch64__))")
+  elseif(module MATCHES "^(cache_er|cache_l1|fan_procfs|fan_sysfs|frequency_sysfs|thermal_sysfs)$")
+    set(_header "exot/meters/${module}.h")
+  elseif(module STREQUAL "frequency_rel")
+    set(_header "exot/meters/frequency.h")
+  elseif(module STREQUAL "utilisation_procfs")
+    set(_header "exot/meters/utilisation.h")
+  else()
+    message(FATAL_ERROR "Unknown meter module in manifest: ${module}")
+  endif()
+  set(${out_header} "${_header}" PARENT_SCOPE)
+  set(${out_qualified} "${_qualified}" PARENT_SCOPE)
+  set(${out_guard} "${_guard}" PARENT_SCOPE)
+endfunction()
+
+# Generates and adds a meter application for each line of the manifest.
+function(exot_meters_from_manifest manifest)
+  if(NOT EXISTS "${manifest}")
+    message(FATAL_ERROR "Meter manifest not found: ${manifest}")
+  endif()
+
+  set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS "${manifest}")
+  file(STRINGS "${manifest}" _lines)
+
+  if(NOT CMAKE_VERSION VERSION_LESS 3.9)
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT _ipo_supported OUTPUT _ipo_output LANGUAGES CXX)
+  else()
+    set(_ipo_supported NO)
+  endif()
+
+  foreach(_line ${_lines})
+    string(REGEX REPLACE "#.*$" "" _line "${_line}")
+    string(STRIP "${_line}" _line)
+    if(_line STREQUAL "")
+      continue()
+    endif()
+
+    string(REGEX REPLACE "[ \t]+" ";" _tokens "${_line}")
+
+    set(_modules "")
+    set(_name "")
+    set(_march "${EXOT_MANIFEST_MARCH}")
+    set(_lto "${EXOT_MANIFEST_LTO}")
+
+    foreach(_token ${_tokens})
+      if(_token MATCHES "^march=(.*)$")
+        set(_march "${CMAKE_MATCH_1}")
+      elseif(_token MATCHES "^lto=(.*)$")
+        set(_lto "${CMAKE_MATCH_1}")
+      elseif(_token MATCHES "^name=(.*)$")
+        set(_name "${CMAKE_MATCH_1}")
+      else()
+        list(APPEND _modules "${_token}")
+      endif()
+    endforeach()
+
+    if(NOT _modules)
+      message(FATAL_ERROR "No modules in manifest line: ${_line}")
+    endif()
+
+    if(_name STREQUAL "")
+      string(REPLACE ";" "+" _name "meter_${_modules}")
+      string(REPLACE "apps::" "" _name "${_name}")
+    endif()
+
+    set(_headers "")
+    set(_guards "")
+    set(_qualified "")
+    foreach(_module ${_modules})
+      exot_meter_module(${_module} _header _type _guard)
+      list(APPEND _headers "${_header}")
+      if(NOT _guard STREQUAL "")
+        list(APPEND _guards "${_guard}")
+      endif()
+      list(APPEND _qualified "${_type}")
+    endforeach()
+
+    list(REMOVE_DUPLICATES _headers)
+    list(SORT _headers)
+    set(METER_INCLUDES "")
+    foreach(_header ${_headers})
+      string(APPEND METER_INCLUDES "#include <${_header}>\n")
+    endforeach()
+
+    if(_guards)
+      list(REMOVE_DUPLICATES _guards)
+      string(REPLACE ";" " && " METER_GUARD "${_guards}")
+    else()
+      set(METER_GUARD "1")
+    endif()
+
+    set(METER_NAME "${_name}")
+    set(METER_MANIFEST "${manifest}")
+    string(REPLACE ";" ", " METER_MODULE_LIST "${_modules}")
+    string(REPLACE ";" ",\n    " METER_MODULES "${_qualified}")
+
+    set(_source "${CMAKE_CURRENT_BINARY_DIR}/meters/${_name}.cpp")
+    configure_file("${EXOT_METER_TEMPLATE}" "${_source}" @ONLY)
+
+    add_executable(${_name} ${_source})
+    target_link_libraries(${_name} PRIVATE exot exot-modules exot-apps)
+    add_dependencies(all-meters ${_name})
+
+    if(NOT _march STREQUAL "")
+      target_compile_options(${_name} PRIVATE "-march=${_march}")
+    endif()
+
+    if(_lto)
+      if(_ipo_supported)
+        set_property(TARGET ${_name} PROPERTY INTERPROCEDURAL_OPTIMIZATION ON)
+      else()
+        message(WARNING "LTO requested for ${_name}, but not supported")
+      endif()
+    endif()
+
+    message(STATUS "Generated meter ${_name} (${METER_MODULE_LIST})")
+  endforeach()
+endfunction()
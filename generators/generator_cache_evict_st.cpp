@@ -34,17 +34,14 @@
 
 #include <chrono>
 
-#include <exot/components/generator_host.h>
-#include <exot/components/schedule_reader.h>
 #include <exot/generators/cache_st.h>
 #include <exot/utilities/main.h>
 
-using loadgen_t =
-    exot::components::generator_host<std::chrono::nanoseconds,
-                                     exot::modules::generator_cache_evict_st>;
-using reader_t =
-    exot::components::schedule_reader<typename loadgen_t::token_type>;
+#include <exot/apps/components/generator_host_rt.h>
+
+using loadgen_t = exot::apps::components::generator_host_rt<
+    std::chrono::nanoseconds, exot::modules::generator_cache_evict_st>;
 
 int main(int argc, char** argv) {
-  return exot::utilities::cli_wrapper<reader_t, loadgen_t>(argc, argv);
+  return exot::utilities::cli_wrapper<loadgen_t>(argc, argv);
 }
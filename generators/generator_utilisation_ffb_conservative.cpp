@@ -40,15 +40,16 @@
 #include <chrono>
 
 #include <exot/components/generator_ffb.h>
-#include <exot/components/schedule_reader.h>
 #include <exot/generators/utilisation_ffb_conservative.h>
 #include <exot/utilities/main.h>
 
+#include <exot/apps/components/schedule_reader_mmap.h>
+
 using loadgen_t = exot::components::generator_ffb<
     std::chrono::nanoseconds,
     exot::modules::generator_utilisation_ffb_conservative>;
-using reader_t =
-    exot::components::schedule_reader<typename loadgen_t::token_type>;
+using reader_t = exot::apps::components::schedule_reader_mmap<
+    typename loadgen_t::token_type>;
 
 int main(int argc, char** argv) {
   return exot::utilities::cli_wrapper<reader_t, loadgen_t>(argc, argv);
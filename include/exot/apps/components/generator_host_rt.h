@@ -0,0 +1,497 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/components/generator_host_rt.h
+ * @author     Bruno Klopott
+ * @brief      A generator host with an embedded schedule reader and a
+ *             lock-free lookahead queue.
+ *
+ * The host hosts the same generator modules as exot::components::
+ * generator_host, but instead of receiving tokens one at a time from a
+ * separate schedule reader, it runs the reader in its own thread. The reader
+ * converts and validates tokens ahead of time and pushes them into a bounded
+ * single-producer single-consumer queue ("lookahead" tokens deep), from
+ * which the host pops without locks or system calls. Only when the queue is
+ * empty, e.g. before the first token arrives on standard input, does the
+ * host sleep on a futex until the reader pushes.
+ *
+ * The reader is configured in the "schedule_reader" section, exactly like
+ * exot::apps::components::schedule_reader_mmap.
+ *
+ * At exit the host reports the number of underruns, i.e. tokens that were
+ * not yet available when due, together with the queue depth observed when
+ * tokens were popped.
+ *
+ * In the "relative" timing mode each token is played for its duration
+ * measured from when it was activated, as in the original host, such that
+ * per-token overheads accumulate over the schedule. In the "absolute" mode
+ * each token ends at a deadline computed from the start of the schedule,
+ * reached with clock_nanosleep(TIMER_ABSTIME) and a final spin-wait, such
+ * that the playback stays phase-locked to the schedule. In both modes the
+ * lateness of token starts against the ideal schedule is reported at exit.
+ *
+ * Tokens are handed to the workers without locks: every worker has a
+ * generation counter, which the host advances for each token, and a counter
+ * of completed loads, which the worker advances. Both sides spin-wait on
+ * the other's counter for "handoff_spin_time" before sleeping on a futex,
+ * and only make a system call to wake a side which fell asleep.
+ *
+ * With "timing_stats" enabled, the lateness of every token start is also
+ * recorded in a preallocated buffer, and percentiles are reported at exit,
+ * optionally together with a histogram written to "timing_file".
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/framework/all.h>
+#include <exot/utilities/configuration.h>
+#include <exot/utilities/thread.h>
+
+#include <exot/apps/components/schedule_reader_mmap.h>
+#include <exot/apps/utilities/deadline.h>
+#include <exot/apps/utilities/futex.h>
+#include <exot/apps/utilities/timing_recorder.h>
+#include <exot/apps/utilities/spsc_queue.h>
+
+#ifndef GENERATOR_HOST_PERFORM_VALIDATION
+#define GENERATOR_HOST_PERFORM_VALIDATION true
+#endif
+
+namespace exot::apps::components {
+
+/**
+ * @brief A generator host fed through a lookahead queue
+ *
+ * @tparam Duration  The duration type of tokens
+ * @tparam Generator The generator module
+ */
+template <typename Duration, typename Generator>
+class generator_host_rt : public exot::framework::IProcess {
+ public:
+  using duration_type    = Duration;
+  using generator_type   = Generator;
+  using subtoken_type    = typename Generator::subtoken_type;
+  using decomposed_type  = typename Generator::decomposed_type;
+  using core_type        = typename Generator::core_type;
+  using index_type       = typename Generator::index_type;
+  using enable_flag_type = typename Generator::enable_flag_type;
+  using token_type       = std::tuple<Duration, subtoken_type>;
+  using policy_type      = exot::utilities::SchedulingPolicy;
+  using state_type       = exot::framework::State;
+  using state_pointer    = std::shared_ptr<state_type>;
+  using logger_pointer   = std::shared_ptr<spdlog::logger>;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::vector<unsigned> cores{};
+    bool should_pin_workers{true};
+    policy_type worker_policy{policy_type::Other};
+    unsigned worker_priority{0u};
+    std::optional<unsigned> self_pinning{std::nullopt};
+    policy_type self_policy{policy_type::Other};
+    unsigned self_priority{0u};
+    unsigned lookahead{4096u};
+    bool start_immediately{false};
+    std::string timing{"relative"};
+    double spin_time{50e-6};
+    double handoff_spin_time{50e-6};
+    bool timing_stats{false};
+    unsigned timing_samples{1u << 20};
+    std::string timing_file{};
+
+    schedule_reader_settings reader;
+    typename Generator::settings generator;
+
+    const char* name() const { return "generator_host"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      this->bind_and_describe_data("cores", cores,
+                                   "cores to run workers on |uint[]|");
+      this->bind_and_describe_data("should_pin_workers", should_pin_workers,
+                                   "pin workers to their cores? |bool|");
+      this->bind_and_describe_data(
+          "worker_policy", worker_policy,
+          "scheduling policy of the workers |str, policy_type|, "
+          "e.g. \"round_robin\"");
+      this->bind_and_describe_data("worker_priority", worker_priority,
+                                   "scheduling priority of the workers "
+                                   "|uint|, in range [0, 99], e.g. 99");
+      this->bind_and_describe_data("self_pinning", self_pinning,
+                                   "host core pinning |uint|");
+      this->bind_and_describe_data(
+          "self_policy", self_policy,
+          "scheduling policy of the host |str, policy_type|, "
+          "e.g. \"round_robin\"");
+      this->bind_and_describe_data("self_priority", self_priority,
+                                   "scheduling priority of the host |uint|, "
+                                   "in range [0, 99], e.g. 99");
+      this->bind_and_describe_data(
+          "lookahead", lookahead,
+          "capacity of the token queue |uint|, rounded up to a power of 2");
+      this->bind_and_describe_data("start_immediately", start_immediately,
+                                   "start playback immediately? |bool|");
+      this->bind_and_describe_data(
+          "timing", timing,
+          "token timing |str|, \"relative\" (from token activation) or "
+          "\"absolute\" (deadlines from the schedule start)");
+      this->bind_and_describe_data(
+          "spin_time", spin_time,
+          "time spent spin-waiting before absolute deadlines |s|, "
+          "e.g. 50e-6");
+      this->bind_and_describe_data(
+          "handoff_spin_time", handoff_spin_time,
+          "time spent spin-waiting on a token hand-off before sleeping "
+          "|s|, e.g. 50e-6");
+      this->bind_and_describe_data(
+          "timing_stats", timing_stats,
+          "record the lateness of every token start? |bool|");
+      this->bind_and_describe_data(
+          "timing_samples", timing_samples,
+          "number of preallocated lateness records |uint|, e.g. 1048576");
+      this->bind_and_describe_data(
+          "timing_file", timing_file,
+          "file for the lateness histogram |str|, e.g. "
+          "\"generator_timing.csv\"");
+
+      reader.set_json(this->get_json());
+      reader.configure();
+      generator.set_json(this->get_json());
+      generator.configure();
+    }
+  };
+
+  explicit generator_host_rt(settings& conf)
+      : conf_{conf},
+        generator_{conf_.generator},
+        source_{conf_.reader},
+        queue_{std::max(conf_.lookahead, 1u)},
+        global_state_{exot::framework::GLOBAL_STATE->get()} {
+    if (conf_.cores.empty())
+      throw std::logic_error("conf->cores must not be empty");
+
+    if (conf_.timing != "relative" && conf_.timing != "absolute")
+      throw std::logic_error("unknown timing mode: " + conf_.timing);
+    if (conf_.spin_time < 0.0 || conf_.handoff_spin_time < 0.0)
+      throw std::logic_error("spin times must not be negative");
+
+    absolute_        = conf_.timing == "absolute";
+    spin_ns_         = static_cast<std::int64_t>(conf_.spin_time * 1e9);
+    handoff_spin_ns_ =
+        static_cast<std::int64_t>(conf_.handoff_spin_time * 1e9);
+
+    if (conf_.timing_stats)
+      recorder_ = std::make_unique<exot::apps::utilities::timing_recorder>(
+          conf_.timing_samples);
+
+    workers_    = std::make_unique<worker_state[]>(conf_.cores.size());
+    decomposed_ = std::vector<decomposed_type>(conf_.cores.size());
+  }
+
+  void process() override {
+    if (conf_.self_pinning.has_value())
+      exot::utilities::ThreadTraits::set_affinity(conf_.self_pinning.value());
+    exot::utilities::ThreadTraits::set_scheduling(conf_.self_policy,
+                                                  conf_.self_priority);
+
+    debug_log_->info(
+        "[generator_host_rt] running on {}, {} workers, lookahead: {}, "
+        "timing: {}",
+        exot::utilities::thread_info(), conf_.cores.size(),
+        queue_.capacity(), conf_.timing);
+
+    std::thread reader{[this] { read(); }};
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < conf_.cores.size(); ++i)
+      workers.emplace_back([this, i] { work(i); });
+
+    while (!global_state_->is_started() && !conf_.start_immediately) {
+      if (global_state_->is_stopped()) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    namespace utl = exot::apps::utilities;
+
+    token_type token;
+    auto deadline = std::int64_t{0};
+
+    while (!global_state_->is_stopped() && next(token)) {
+      auto now = utl::monotonic_ns();
+      if (tokens_ == 1) deadline = now;
+      lateness_.add(now - deadline);
+      if (recorder_) recorder_->record(deadline, now);
+
+      activate(std::get<1>(token));
+      deadline += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::get<0>(token))
+                      .count();
+
+      if (absolute_) {
+        utl::wait_until_ns(deadline, spin_ns_);
+      } else {
+        std::this_thread::sleep_for(std::get<0>(token));
+      }
+
+      deactivate();
+    }
+
+    finished_.store(true, std::memory_order_release);
+    for (std::size_t i = 0; i < conf_.cores.size(); ++i)
+      workers_[i].generation.advance();
+    stop_reader_.store(true, std::memory_order_release);
+
+    for (auto& worker : workers) worker.join();
+    reader.join();
+
+    report();
+    global_state_->stop();
+  }
+
+ private:
+  // how often a host waiting for tokens checks the global state
+  static constexpr std::int64_t stop_poll_ns = 1000000;
+  // how long the reader sleeps when the queue is full
+  static constexpr std::chrono::microseconds reader_backoff{100};
+
+  struct alignas(64) worker_state {
+    enable_flag_type flag{false};
+    exot::apps::utilities::generation_counter generation;
+    exot::apps::utilities::generation_counter done;  //! completed loads
+  };
+
+  /**
+   * @brief Fills the queue with validated tokens, runs in its own thread
+   * @details Errors of the schedule input, e.g. a missing file or a
+   *          malformed line, end the schedule and stop the global state
+   *          rather than escaping the thread.
+   */
+  void read() {
+    if (conf_.reader.cpu_to_pin.has_value())
+      exot::utilities::ThreadTraits::set_affinity(
+          conf_.reader.cpu_to_pin.value());
+
+    auto stopped = [this] {
+      return stop_reader_.load(std::memory_order_acquire) ||
+             global_state_->is_stopped();
+    };
+
+    try {
+      auto count = source_.play(
+          [this, &stopped](token_type&& token) {
+            if constexpr (GENERATOR_HOST_PERFORM_VALIDATION) {
+              if (!generator_.validate_subtoken(std::get<1>(token))) {
+                ++invalid_;
+                return;
+              }
+            }
+
+            // a full queue drains at the pace of the schedule
+            while (!queue_.try_push(std::move(token))) {
+              if (stopped()) return;
+              std::this_thread::sleep_for(reader_backoff);
+            }
+            pushed_.advance();
+          },
+          stopped);
+
+      debug_log_->info("[generator_host_rt] reader produced {} tokens",
+                       count);
+    } catch (const std::exception& e) {
+      debug_log_->error("[generator_host_rt] reading the schedule failed: {}",
+                        e.what());
+      global_state_->stop();
+    }
+
+    reader_done_.store(true, std::memory_order_release);
+    pushed_.advance();
+  }
+
+  /**
+   * @brief Pops the next token, waiting if the reader falls behind
+   * @details The host spins for "handoff_spin_time" and then sleeps until
+   *          the reader pushes a token, waking periodically to check if the
+   *          global state was stopped, e.g. while the reader blocks on
+   *          standard input.
+   * @return False if the schedule has ended
+   */
+  bool next(token_type& token) {
+    if (!queue_.try_pop(token)) {
+      auto done = false;
+      auto seen = pushed_.load();
+      while (!queue_.try_pop(token)) {
+        // one more attempt is made after the reader is seen to be done
+        if (done || global_state_->is_stopped()) return false;
+        done = reader_done_.load(std::memory_order_acquire);
+        if (!done) seen = pushed_.wait(seen, handoff_spin_ns_, stop_poll_ns);
+      }
+
+      if (tokens_ != 0) ++underruns_;
+    }
+
+    auto depth = static_cast<std::uint64_t>(queue_.size());
+    depth_sum_ += depth;
+    min_depth_ = std::min(min_depth_, depth);
+    ++tokens_;
+    return true;
+  }
+
+  /**
+   * @brief Hands a subtoken to the workers
+   * @details Waits until every worker has completed the previous load,
+   *          which it does as soon as its enable flag is cleared, such that
+   *          the worker's decomposed subtoken can be replaced. Workers
+   *          which are asleep are woken by advancing their generation.
+   */
+  void activate(const subtoken_type& subtoken) {
+    for (std::size_t i = 0; i < conf_.cores.size(); ++i) {
+      auto& worker = workers_[i];
+      auto done    = worker.done.load();
+      if (done != generation_) worker.done.wait(done, handoff_spin_ns_);
+
+      decomposed_[i] = generator_.decompose_subtoken(
+          subtoken, static_cast<core_type>(conf_.cores[i]),
+          static_cast<index_type>(i));
+      worker.flag.store(true, std::memory_order_release);
+    }
+
+    ++generation_;
+    for (std::size_t i = 0; i < conf_.cores.size(); ++i)
+      workers_[i].generation.advance();
+  }
+
+  void deactivate() {
+    for (std::size_t i = 0; i < conf_.cores.size(); ++i)
+      workers_[i].flag.store(false, std::memory_order_release);
+  }
+
+  /**
+   * @brief The worker loop, runs in its own thread
+   */
+  void work(std::size_t index) {
+    const auto core = conf_.cores.at(index);
+    if (conf_.should_pin_workers)
+      exot::utilities::ThreadTraits::set_affinity(core);
+    exot::utilities::ThreadTraits::set_scheduling(conf_.worker_policy,
+                                                  conf_.worker_priority);
+
+    auto& state = workers_[index];
+    auto seen   = std::uint32_t{0};
+
+    while (true) {
+      seen = state.generation.wait(seen, handoff_spin_ns_);
+      if (finished_.load(std::memory_order_acquire)) break;
+
+      generator_.generate_load(decomposed_[index], state.flag,
+                               static_cast<core_type>(core),
+                               static_cast<index_type>(index));
+      state.done.advance();
+    }
+  }
+
+  void report() {
+    debug_log_->info(
+        "[generator_host_rt] played {} tokens, {} underruns, queue depth "
+        "mean: {:.1f}, min: {}",
+        tokens_, underruns_,
+        tokens_ ? static_cast<double>(depth_sum_) / tokens_ : 0.0,
+        tokens_ ? min_depth_ : 0);
+
+    debug_log_->info(
+        "[generator_host_rt] token start lateness [ns], mean: {:.0f}, min: "
+        "{}, max: {}",
+        lateness_.mean(), lateness_.count ? lateness_.min : 0,
+        lateness_.count ? lateness_.max : 0);
+
+    if (recorder_) {
+      debug_log_->info(
+          "[generator_host_rt] token starts: {}",
+          exot::apps::utilities::timing_recorder::format(
+              recorder_->summarise()));
+      if (!conf_.timing_file.empty())
+        recorder_->write(conf_.timing_file, "generator_host_rt");
+    }
+
+    if (invalid_ != 0)
+      debug_log_->warn("[generator_host_rt] skipped {} invalid tokens",
+                       invalid_.load());
+    if (underruns_ != 0)
+      debug_log_->warn(
+          "[generator_host_rt] the reader could not keep up with the "
+          "schedule, consider a larger lookahead or a binary schedule");
+  }
+
+  settings conf_;
+  Generator generator_;
+  schedule_source<token_type> source_;
+  exot::apps::utilities::spsc_queue<token_type> queue_;
+  state_pointer global_state_;
+
+  std::unique_ptr<worker_state[]> workers_;
+  std::vector<decomposed_type> decomposed_;
+  std::uint32_t generation_{0};  //! only accessed by the host
+  std::atomic<bool> finished_{false};
+
+  std::atomic<bool> reader_done_{false};
+  exot::apps::utilities::generation_counter pushed_;  //! tokens pushed
+  std::atomic<bool> stop_reader_{false};
+  std::atomic<std::uint64_t> invalid_{0};
+
+  std::uint64_t tokens_{0};
+  std::uint64_t underruns_{0};
+  std::uint64_t depth_sum_{0};
+  std::uint64_t min_depth_{std::numeric_limits<std::uint64_t>::max()};
+
+  bool absolute_{false};
+  std::int64_t spin_ns_{0};
+  std::int64_t handoff_spin_ns_{0};
+  exot::apps::utilities::lateness_statistics lateness_;
+  std::unique_ptr<exot::apps::utilities::timing_recorder> recorder_;
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::components
@@ -0,0 +1,750 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/components/meter_host_sink.h
+ * @author     Bruno Klopott
+ * @brief      A meter host writing samples to a selectable output sink.
+ *
+ * The host is a drop-in replacement for components::meter_host_logger. In
+ * the "text" output format samples are formatted as CSV lines and passed to
+ * the application logger, like in the original host. In the "binary" format
+ * each sample is packed into a fixed-width record in a preallocated buffer,
+ * which avoids text formatting on the sampling path altogether. Binary files
+ * can be converted to CSV with utilities/utility_meter_decode.
+ *
+ * Binary records are written either through a preallocated buffer flushed
+ * with write(2) when full ("buffered" sink), or through a memory-mapped ring
+ * buffer drained by a background thread ("mmap_ring" sink), in which case
+ * sampling never waits on disk I/O.
+ *
+ * The set of active modules can be restricted at runtime with the "meters"
+ * setting. Inactive modules are neither configured nor constructed, and the
+ * sampling loop only dispatches to active modules through a table built at
+ * construction, such that a single host instantiated with all modules can
+ * replace hand-written combinations.
+ *
+ * Binary records can be delta-coded per column ("output_encoding": "delta"),
+ * and, with the buffered sink, compressed in LZ4 blocks
+ * ("output_compression": "lz4", if available at build time).
+ *
+ * In the adaptive mode the sampling period varies between "period" and
+ * "max_period": it is reset to the shortest period whenever any channel
+ * changes by more than "adaptive_threshold" between samples, and multiplied
+ * by "adaptive_backoff" while all channels stay flat. Samples are always
+ * stamped with the time at which they were taken.
+ *
+ * Modules can be sampled at lower rates than the base "period", given per
+ * module as integer multiples of it in "meter_periods", such that slowly
+ * changing and expensive channels are not read on every sample. Samples
+ * always contain all channels: in the text format the channels of modules
+ * not sampled at a given tick are left empty, and in the binary format they
+ * repeat the previous reading, which the delta encoding reduces to zeros,
+ * and a leading "sampled" channel holds a bitmask of the modules, in
+ * declaration order, which were sampled at that tick.
+ *
+ * With "timing_stats" enabled, the lateness of every sample against its
+ * intended time is recorded in a preallocated buffer, and percentiles are
+ * reported at exit, optionally together with a histogram written to
+ * "timing_file".
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/framework/all.h>
+#include <exot/utilities/configuration.h>
+#include <exot/utilities/thread.h>
+
+#include <exot/apps/utilities/binary_format.h>
+#include <exot/apps/utilities/channels.h>
+#include <exot/apps/utilities/delta_encoding.h>
+#include <exot/apps/utilities/meter_output.h>
+#include <exot/apps/utilities/timing_recorder.h>
+
+namespace exot::apps::components {
+
+/**
+ * @brief A meter host with text and binary output formats
+ *
+ * @tparam Duration The duration type used for timestamps
+ * @tparam Meters   The meter modules
+ */
+template <typename Duration, typename... Meters>
+class meter_host_sink : public exot::framework::IProcess {
+  static_assert(sizeof...(Meters) >= 1 && sizeof...(Meters) <= 64,
+                "the host supports between 1 and 64 modules");
+
+ public:
+  using duration_type = Duration;
+  using clock_type    = std::chrono::steady_clock;
+  using meter_types   = std::tuple<Meters...>;
+  using policy_type   = exot::utilities::SchedulingPolicy;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    double period{0.01};
+    bool adaptive{false};
+    double max_period{1.0};
+    double adaptive_threshold{0.0};
+    double adaptive_backoff{2.0};
+    bool should_pin_host{false};
+    unsigned host_pinning{0u};
+    policy_type host_policy{policy_type::Other};
+    unsigned host_priority{0u};
+    bool log_header{true};
+    bool start_immediately{false};
+    std::string output_format{"text"};
+    std::string output_file{};
+    unsigned buffer_records{4096u};
+    std::string output_sink{"buffered"};
+    std::string output_encoding{"raw"};
+    std::string output_compression{"none"};
+    unsigned ring_size{16u << 20};
+    std::string ring_directory{"/dev/shm"};
+    std::optional<unsigned> drainer_pinning{std::nullopt};
+    std::vector<std::string> meters{};
+    std::map<std::string, unsigned> meter_periods{};
+    bool timing_stats{false};
+    unsigned timing_samples{1u << 20};
+    std::string timing_file{};
+
+    std::tuple<typename Meters::settings...> meter_settings;
+
+    const char* name() const { return "meter"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      this->bind_and_describe_data("period", period, "sampling period |s|");
+      this->bind_and_describe_data(
+          "adaptive", adaptive,
+          "adapt the sampling period to signal changes? |bool|");
+      this->bind_and_describe_data(
+          "max_period", max_period,
+          "longest sampling period in the adaptive mode |s|, e.g. 1.0");
+      this->bind_and_describe_data(
+          "adaptive_threshold", adaptive_threshold,
+          "smallest absolute change of any channel that resets the period "
+          "in the adaptive mode |float|");
+      this->bind_and_describe_data(
+          "adaptive_backoff", adaptive_backoff,
+          "factor by which the period grows while signals are flat |float|, "
+          "e.g. 2.0");
+      this->bind_and_describe_data("should_pin_host", should_pin_host,
+                             "pin the host thread? |bool|");
+      this->bind_and_describe_data("host_pinning", host_pinning,
+                             "host core pinning |uint|");
+      this->bind_and_describe_data(
+          "host_policy", host_policy,
+          "scheduling policy of the host |str, policy_type|, "
+          "e.g. \"round_robin\"");
+      this->bind_and_describe_data("host_priority", host_priority,
+                             "scheduling priority of the host |uint|, in "
+                             "range [0, 99], e.g. 99");
+      this->bind_and_describe_data("log_header", log_header,
+                             "output the channel header? |bool|");
+      this->bind_and_describe_data("start_immediately", start_immediately,
+                             "start sampling immediately? |bool|");
+      this->bind_and_describe_data(
+          "output_format", output_format,
+          "output format |str|, \"text\" (CSV via the app log) or "
+          "\"binary\" (fixed-width records)");
+      this->bind_and_describe_data(
+          "output_file", output_file,
+          "output file for non-text formats |str|, e.g. \"meter.bin\"");
+      this->bind_and_describe_data("buffer_records", buffer_records,
+                             "number of records buffered before writing out "
+                             "|uint|, e.g. 4096");
+      this->bind_and_describe_data(
+          "output_sink", output_sink,
+          "sink for non-text formats |str|, \"buffered\" or \"mmap_ring\"");
+      this->bind_and_describe_data(
+          "output_encoding", output_encoding,
+          "encoding of binary records |str|, \"raw\" or \"delta\"");
+      this->bind_and_describe_data(
+          "output_compression", output_compression,
+          "block compression of the buffered sink |str|, \"none\" or "
+          "\"lz4\"");
+      this->bind_and_describe_data(
+          "ring_size", ring_size,
+          "size of the mmap_ring sink's buffer |uint, bytes|, e.g. 16777216");
+      this->bind_and_describe_data(
+          "ring_directory", ring_directory,
+          "directory of the mmap_ring sink's buffer file |str|, preferably "
+          "on tmpfs, anonymous memory if empty");
+      this->bind_and_describe_data(
+          "drainer_pinning", drainer_pinning,
+          "core pinning of the mmap_ring sink's drainer thread |uint|");
+      this->bind_and_describe_data(
+          "timing_stats", timing_stats,
+          "record the lateness of every sample? |bool|");
+      this->bind_and_describe_data(
+          "timing_samples", timing_samples,
+          "number of preallocated lateness records |uint|, e.g. 1048576");
+      this->bind_and_describe_data(
+          "timing_file", timing_file,
+          "file for the lateness histogram |str|, e.g. \"meter_timing.csv\"");
+
+      this->bind_and_describe_data(
+          "meters", meters,
+          "names of the active modules |str[]|, e.g. [\"thermal_msr\"], "
+          "all available modules are active if empty");
+      this->bind_and_describe_data(
+          "meter_periods", meter_periods,
+          "sampling periods of modules as multiples of the period "
+          "|{str: uint}|, e.g. {\"frequency_sysfs\": 100}, 1 if not given");
+
+      std::apply(
+          [this](auto&... meter_settings) {
+            ((is_active(meter_settings.name())
+                  ? (meter_settings.set_json(this->get_json()),
+                     meter_settings.configure(), void())
+                  : void()),
+             ...);
+          },
+          meter_settings);
+    }
+
+    /**
+     * @brief Checks if a module with a given name is selected
+     */
+    bool is_active(const std::string& name) const {
+      return meters.empty() ||
+             std::find(meters.begin(), meters.end(), name) != meters.end();
+    }
+  };
+
+  explicit meter_host_sink(settings& conf)
+      : conf_{conf}, global_state_{exot::framework::GLOBAL_STATE->get()} {
+    for (const auto& name : conf_.meters) {
+      auto known = false;
+      std::apply(
+          [&](const auto&... s) { known = ((name == s.name()) || ...); },
+          conf_.meter_settings);
+      if (!known) throw std::logic_error("unknown meter module: " + name);
+    }
+
+    for (const auto& [name, multiple] : conf_.meter_periods) {
+      auto known = false;
+      std::apply(
+          [&](const auto&... s) { known = ((name == s.name()) || ...); },
+          conf_.meter_settings);
+      if (!known) throw std::logic_error("unknown meter module: " + name);
+      if (multiple == 0)
+        throw std::logic_error("conf->meter_periods must be positive");
+    }
+
+    construct(std::index_sequence_for<Meters...>{});
+
+    if (conf_.period <= 0.0)
+      throw std::logic_error("conf->period must be positive");
+
+    if (conf_.output_format == "binary") {
+      format_ = output_format::binary;
+    } else if (conf_.output_format == "text") {
+      format_ = output_format::text;
+    } else {
+      throw std::logic_error("unknown output format: " + conf_.output_format);
+    }
+
+    if (format_ != output_format::text && conf_.output_file.empty())
+      throw std::logic_error("conf->output_file is required for format " +
+                             conf_.output_format);
+
+    if (conf_.output_sink != "buffered" && conf_.output_sink != "mmap_ring")
+      throw std::logic_error("unknown output sink: " + conf_.output_sink);
+
+    if (conf_.output_encoding != "raw" && conf_.output_encoding != "delta")
+      throw std::logic_error("unknown output encoding: " +
+                             conf_.output_encoding);
+    if (conf_.output_compression != "none" &&
+        conf_.output_compression != "lz4")
+      throw std::logic_error("unknown output compression: " +
+                             conf_.output_compression);
+    if (conf_.output_compression == "lz4" && conf_.output_sink != "buffered")
+      throw std::logic_error("lz4 compression requires the buffered sink");
+
+    // the ring must at least accommodate the header
+    if (conf_.output_sink == "mmap_ring" && conf_.ring_size < 65536u)
+      throw std::logic_error("conf->ring_size must be at least 65536");
+
+    if (conf_.adaptive) {
+      if (conf_.max_period < conf_.period)
+        throw std::logic_error("conf->max_period must not be below period");
+      if (conf_.adaptive_backoff <= 1.0)
+        throw std::logic_error("conf->adaptive_backoff must be above 1");
+      if (conf_.adaptive_threshold < 0.0)
+        throw std::logic_error("conf->adaptive_threshold must not be negative");
+    }
+
+    period_ = std::chrono::duration_cast<clock_type::duration>(
+        std::chrono::duration<double>{conf_.period});
+    max_period_ = std::chrono::duration_cast<clock_type::duration>(
+        std::chrono::duration<double>{conf_.max_period});
+    current_period_ = period_;
+
+    if (conf_.timing_stats)
+      recorder_ = std::make_unique<exot::apps::utilities::timing_recorder>(
+          conf_.timing_samples);
+  }
+
+  void process() override {
+    if (conf_.should_pin_host)
+      exot::utilities::ThreadTraits::set_affinity(conf_.host_pinning);
+    exot::utilities::ThreadTraits::set_scheduling(conf_.host_policy,
+                                                  conf_.host_priority);
+
+    debug_log_->info(
+        "[meter_host_sink] running on {}, output format: {}, {} of {} "
+        "modules active",
+        exot::utilities::thread_info(), conf_.output_format, dispatch_size_,
+        sizeof...(Meters));
+    if (multi_rate_)
+      debug_log_->info("[meter_host_sink] module periods: {} times {}s",
+                       fmt::join(multiples_.begin(),
+                                 multiples_.begin() + dispatch_size_, ", "),
+                       conf_.period);
+
+    while (!global_state_->is_started() && !conf_.start_immediately) {
+      if (global_state_->is_stopped()) return;
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    auto next = clock_type::now();
+    auto samples = std::uint64_t{0};
+
+    while (!global_state_->is_stopped()) {
+      auto timestamp = clock_type::now();
+      if (recorder_)
+        recorder_->record(nanoseconds(next), nanoseconds(timestamp));
+      measure();
+
+      if (samples == 0) open();
+      write(timestamp);
+
+      ++samples;
+      if (conf_.adaptive) adapt();
+      next += current_period_;
+      std::this_thread::sleep_until(next);
+    }
+
+    close();
+
+    debug_log_->info("[meter_host_sink] finished after {} samples", samples);
+    if (mismatched_samples_ != 0)
+      debug_log_->warn(
+          "[meter_host_sink] {} samples dropped for not matching the layout",
+          mismatched_samples_);
+    if (conf_.adaptive)
+      debug_log_->info("[meter_host_sink] adaptive period was reset {} times",
+                       period_resets_);
+
+    if (recorder_) {
+      debug_log_->info("[meter_host_sink] samples: {}",
+                       exot::apps::utilities::timing_recorder::format(
+                           recorder_->summarise()));
+      if (!conf_.timing_file.empty())
+        recorder_->write(conf_.timing_file, "meter_host_sink");
+    }
+  }
+
+ private:
+  enum class output_format { text, binary };
+
+  using readings_type =
+      std::tuple<decltype(std::declval<Meters&>().measure())...>;
+  using state_type     = exot::framework::State;
+  using state_pointer  = std::shared_ptr<state_type>;
+  using logger_pointer = std::shared_ptr<spdlog::logger>;
+
+  using dispatch_type = void (meter_host_sink::*)();
+
+  static constexpr std::uint64_t bit(std::size_t index) {
+    return std::uint64_t{1} << index;
+  }
+
+  static std::int64_t nanoseconds(clock_type::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               time.time_since_epoch())
+        .count();
+  }
+
+  /**
+   * @brief Constructs the active modules and fills the dispatch table
+   */
+  template <std::size_t... I>
+  void construct(std::index_sequence<I...>) {
+    (((conf_.is_active(std::get<I>(conf_.meter_settings).name()))
+          ? (std::get<I>(meters_).emplace(std::get<I>(conf_.meter_settings)),
+             active_ |= bit(I), add_dispatch<I>(), void())
+          : void()),
+     ...);
+  }
+
+  /**
+   * @brief Appends a module to the dispatch table with its period
+   */
+  template <std::size_t I>
+  void add_dispatch() {
+    auto name     = std::string{std::get<I>(conf_.meter_settings).name()};
+    auto period   = conf_.meter_periods.find(name);
+    auto multiple = period != conf_.meter_periods.end() ? period->second : 1u;
+
+    dispatch_[dispatch_size_]  = &meter_host_sink::template sample<I>;
+    multiples_[dispatch_size_] = multiple;
+    countdown_[dispatch_size_] = 1;
+    modules_[dispatch_size_]   = bit(I);
+    ++dispatch_size_;
+    multi_rate_ = multi_rate_ || multiple > 1;
+  }
+
+  /**
+   * @brief Takes a reading from a single module
+   */
+  template <std::size_t I>
+  void sample() {
+    std::get<I>(readings_) = std::get<I>(meters_)->measure();
+  }
+
+  /**
+   * @brief Takes a reading from all active modules due at this tick, in
+   *        declaration order
+   */
+  inline void measure() {
+    sampled_ = 0;
+    for (auto i = 0u; i < dispatch_size_; ++i) {
+      if (--countdown_[i] != 0) continue;
+      (this->*dispatch_[i])();
+      countdown_[i] = multiples_[i];
+      sampled_ |= modules_[i];
+    }
+  }
+
+  /**
+   * @brief Adapts the sampling period to the change since the last sample
+   */
+  void adapt() {
+    auto changed = false;
+    auto index   = std::size_t{0};
+
+    visit_active(
+        [&, this](auto value) {
+          auto current = static_cast<double>(value);
+          if (index < previous_.size()) {
+            changed |= std::abs(current - previous_[index]) >
+                       conf_.adaptive_threshold;
+            previous_[index] = current;
+          } else {
+            previous_.push_back(current);
+          }
+          ++index;
+        },
+        std::index_sequence_for<Meters...>{});
+
+    if (changed) {
+      if (current_period_ != period_) ++period_resets_;
+      current_period_ = period_;
+    } else {
+      current_period_ = std::min(
+          max_period_, std::chrono::duration_cast<clock_type::duration>(
+                           current_period_ * conf_.adaptive_backoff));
+    }
+  }
+
+  /**
+   * @brief Describes the channels and prepares the output
+   * @details The layout is determined from the first reading, since the
+   *          number of channels of most modules depends on their settings.
+   */
+  void open() {
+    layout_.channels.clear();
+    layout_.channels.push_back(
+        {"timestamp", exot::apps::utilities::channel_type::i64});
+
+    if (multi_rate_ && format_ == output_format::binary)
+      layout_.channels.push_back(
+          {"sampled", exot::apps::utilities::channel_type::u64});
+
+    describe(std::index_sequence_for<Meters...>{});
+
+    if (format_ == output_format::text) {
+      if (conf_.log_header) {
+        auto line = fmt::memory_buffer{};
+        for (auto i = 0u; i < layout_.channels.size(); ++i)
+          fmt::format_to(std::back_inserter(line), i == 0 ? "{}" : ",{}",
+                         layout_.channels[i].name);
+        application_log_->info("{}", fmt::to_string(line));
+      }
+      return;
+    }
+
+    // The timestamp is part of the record, not of the channel list.
+    auto channels = std::move(layout_.channels);
+    layout_.channels.assign(std::next(channels.begin()), channels.end());
+    record_.resize(layout_.record_size());
+
+    auto compress = conf_.output_compression == "lz4";
+    if (compress) layout_.flags |= exot::apps::utilities::lz4_blocks;
+
+    if (conf_.output_encoding == "delta") {
+      layout_.encoding = exot::apps::utilities::record_encoding::delta;
+      encoder_ =
+          std::make_unique<exot::apps::utilities::delta_encoder>(layout_);
+      encoded_.resize(encoder_->max_encoded_size());
+    }
+
+    auto header = exot::apps::utilities::serialise_header(layout_);
+
+    if (conf_.output_sink == "mmap_ring") {
+      auto ring = std::make_unique<exot::apps::utilities::mmap_ring_writer>(
+          conf_.output_file, conf_.ring_size, conf_.ring_directory,
+          conf_.drainer_pinning);
+      ring->append(header.data(), header.size());
+      ring_ = ring.get();
+      sink_ = std::move(ring);
+    } else {
+      auto buffered =
+          std::make_unique<exot::apps::utilities::buffered_file_writer>(
+              conf_.output_file,
+              record_.size() * std::max<std::size_t>(1u, conf_.buffer_records),
+              compress);
+      buffered->write_header(header.data(), header.size());
+      sink_ = std::move(buffered);
+    }
+  }
+
+  /**
+   * @brief Flushes the output and reports the sink's statistics
+   */
+  void close() {
+    if (!sink_) return;
+    sink_->flush();
+
+    if (ring_ != nullptr) {
+      ring_->stop();
+      auto stats = ring_->get_statistics();
+
+      debug_log_->info(
+          "[meter_host_sink] ring buffer: {} chunks, {} bytes drained, "
+          "max occupancy {} bytes",
+          stats.appended_chunks, stats.drained_bytes, stats.max_occupancy);
+
+      if (stats.overrun_chunks != 0)
+        debug_log_->warn("[meter_host_sink] ring buffer overruns: {} records "
+                         "({} bytes) dropped",
+                         stats.overrun_chunks, stats.overrun_bytes);
+      if (stats.drainer_failed)
+        debug_log_->error("[meter_host_sink] ring buffer drainer failed to "
+                          "write to {}",
+                          conf_.output_file);
+    }
+
+    sink_.reset();
+    ring_ = nullptr;
+  }
+
+  /**
+   * @brief Describes the channels of all active modules and records their
+   *        number, which every later sample must match
+   */
+  template <std::size_t... I>
+  void describe(std::index_sequence<I...>) {
+    (((active_ & bit(I))
+          ? (exot::apps::utilities::describe_channels(
+                 std::get<I>(readings_), std::get<I>(meters_)->header(),
+                 std::get<I>(conf_.meter_settings).name(), layout_.channels),
+             channel_counts_[I] = exot::apps::utilities::count_channels(
+                 std::get<I>(readings_)),
+             void())
+          : void()),
+     ...);
+  }
+
+  /**
+   * @brief Checks that every active module's reading has as many channels
+   *        as its first reading, which determined the output layout
+   * @details Modules returning vectors may return fewer or more values when
+   *          some of their sources fail. Such samples do not fit the layout
+   *          and are dropped; the first mismatch is logged.
+   */
+  template <std::size_t... I>
+  bool matches_layout(std::index_sequence<I...>) {
+    auto matches = true;
+    (((active_ & bit(I)) && matches
+          ? (matches = check_channels<I>(), void())
+          : void()),
+     ...);
+    return matches;
+  }
+
+  template <std::size_t I>
+  bool check_channels() {
+    auto count = exot::apps::utilities::count_channels(std::get<I>(readings_));
+    if (count == channel_counts_[I]) return true;
+
+    if (mismatched_samples_ == 0)
+      debug_log_->warn(
+          "[meter_host_sink] module {} returned {} channels instead of {}, "
+          "dropping samples which do not match the output layout",
+          std::get<I>(conf_.meter_settings).name(), count,
+          channel_counts_[I]);
+    return false;
+  }
+
+  /**
+   * @brief Visits the channels of all active modules
+   */
+  template <typename Visitor, std::size_t... I>
+  inline void visit_active(Visitor&& visitor, std::index_sequence<I...>) {
+    (((active_ & bit(I))
+          ? exot::apps::utilities::visit_channels(std::get<I>(readings_),
+                                                  visitor)
+          : void()),
+     ...);
+  }
+
+  /**
+   * @brief Visits the channels of all active modules, along with whether
+   *        the module was sampled at the current tick
+   */
+  template <typename Visitor, std::size_t... I>
+  inline void visit_sampled(Visitor&& visitor, std::index_sequence<I...>) {
+    (((active_ & bit(I))
+          ? exot::apps::utilities::visit_channels(
+                std::get<I>(readings_),
+                [&visitor, fresh = (sampled_ & bit(I)) != 0](auto value) {
+                  visitor(value, fresh);
+                })
+          : void()),
+     ...);
+  }
+
+  /**
+   * @brief Writes a single sample to the selected output
+   */
+  void write(clock_type::time_point timestamp) {
+    if (!matches_layout(std::index_sequence_for<Meters...>{})) {
+      ++mismatched_samples_;
+      return;
+    }
+
+    auto ticks = static_cast<std::int64_t>(
+        std::chrono::duration_cast<duration_type>(timestamp.time_since_epoch())
+            .count());
+
+    if (format_ == output_format::text) {
+      auto line = fmt::memory_buffer{};
+      fmt::format_to(std::back_inserter(line), "{}", ticks);
+      visit_sampled(
+          [&line](auto value, bool fresh) {
+            if (fresh) {
+              fmt::format_to(std::back_inserter(line), ",{}", value);
+            } else {
+              line.push_back(',');
+            }
+          },
+          std::index_sequence_for<Meters...>{});
+      application_log_->info("{}", fmt::to_string(line));
+      return;
+    }
+
+    auto* destination = record_.data();
+    exot::apps::utilities::pack_value(destination, ticks);
+    if (multi_rate_) exot::apps::utilities::pack_value(destination, sampled_);
+    visit_active(
+        [&destination](auto value) {
+          exot::apps::utilities::pack_value(destination, value);
+        },
+        std::index_sequence_for<Meters...>{});
+
+    if (encoder_) {
+      auto size = encoder_->encode(record_.data(), encoded_.data());
+      if (sink_->append(encoded_.data(), size)) encoder_->commit();
+    } else {
+      sink_->append(record_.data(), record_.size());
+    }
+  }
+
+
+  settings conf_;
+  state_pointer global_state_;
+  std::tuple<std::optional<Meters>...> meters_;
+  readings_type readings_;
+
+  std::uint64_t active_{0};
+  std::array<dispatch_type, sizeof...(Meters)> dispatch_{};
+  std::array<unsigned, sizeof...(Meters)> multiples_{};
+  std::array<unsigned, sizeof...(Meters)> countdown_{};
+  std::array<std::uint64_t, sizeof...(Meters)> modules_{};  //! module bits
+  std::size_t dispatch_size_{0};
+  std::array<std::size_t, sizeof...(Meters)> channel_counts_{};
+  std::uint64_t mismatched_samples_{0};
+  std::uint64_t sampled_{0};  //! modules sampled at the current tick
+  bool multi_rate_{false};
+
+  output_format format_{output_format::text};
+  clock_type::duration period_;
+  clock_type::duration max_period_;
+  clock_type::duration current_period_;
+  std::vector<double> previous_;
+  std::uint64_t period_resets_{0};
+  exot::apps::utilities::binary_layout layout_;
+  std::vector<char> record_;
+  std::vector<char> encoded_;
+  std::unique_ptr<exot::apps::utilities::delta_encoder> encoder_;
+  std::unique_ptr<exot::apps::utilities::output_sink> sink_;
+  exot::apps::utilities::mmap_ring_writer* ring_{nullptr};
+  std::unique_ptr<exot::apps::utilities::timing_recorder> recorder_;
+
+  logger_pointer application_log_ =
+      spdlog::get("app") ? spdlog::get("app") : spdlog::stdout_color_mt("app");
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::components
@@ -0,0 +1,274 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/components/schedule_reader_mmap.h
+ * @author     Bruno Klopott
+ * @brief      A schedule reader playing back memory-mapped binary schedules.
+ *
+ * The reader is a drop-in replacement for exot::components::schedule_reader.
+ * Binary schedules (see exot/apps/utilities/schedule_file.h) are mapped into
+ * memory and tokens are produced without parsing or allocation, with pages
+ * ahead of the playback cursor prefetched in batches. Text schedules are
+ * still accepted and parsed line by line, such that existing configurations
+ * keep working; they can be converted to the binary format with
+ * utilities/utility_schedule_convert.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/framework/all.h>
+#include <exot/utilities/configuration.h>
+#include <exot/utilities/thread.h>
+
+#include <exot/apps/utilities/schedule_file.h>
+
+namespace exot::apps::components {
+
+/**
+ * @brief Settings of the schedule reader, shared by all token types
+ */
+struct schedule_reader_settings
+    : public exot::utilities::configurable<schedule_reader_settings> {
+  std::string input_file{};
+  bool reading_from_file{true};
+  bool read_as_hex{false};
+  std::string text_unit{"ns"};
+  unsigned prefetch_distance{4096u};
+  bool populate{false};
+  std::optional<unsigned> cpu_to_pin{std::nullopt};
+
+  const char* name() const { return "schedule_reader"; }
+
+  /* @brief The JSON configuration function */
+  void configure() {
+    bind_and_describe_data("input_file", input_file,
+                           "schedule file |str|, binary or text");
+    bind_and_describe_data("reading_from_file", reading_from_file,
+                           "read the schedule from a file? |bool|, reads "
+                           "text from the standard input otherwise");
+    bind_and_describe_data("read_as_hex", read_as_hex,
+                           "are integral text subtokens hexadecimal? "
+                           "|bool|");
+    bind_and_describe_data("text_unit", text_unit,
+                           "duration unit of text schedules |str|, \"ns\", "
+                           "\"us\", \"ms\" or \"s\"");
+    bind_and_describe_data("prefetch_distance", prefetch_distance,
+                           "records prefetched ahead of the playback cursor "
+                           "|uint|, e.g. 4096");
+    bind_and_describe_data("populate", populate,
+                           "fault in the whole binary schedule when mapping? "
+                           "|bool|");
+    bind_and_describe_data("cpu_to_pin", cpu_to_pin,
+                           "reader core pinning |uint|");
+  }
+};
+
+/**
+ * @brief Plays back a binary or text schedule as tokens
+ *
+ * @tparam Token The token type, a tuple of a duration and a subtoken
+ */
+template <typename Token>
+class schedule_source {
+ public:
+  using token_type    = Token;
+  using duration_type = std::tuple_element_t<0, Token>;
+  using subtoken_type = std::tuple_element_t<1, Token>;
+
+  explicit schedule_source(const schedule_reader_settings& conf)
+      : conf_{conf} {
+    if (conf_.reading_from_file && conf_.input_file.empty())
+      throw std::logic_error("conf->input_file is required");
+
+    unit_ = exot::apps::utilities::schedule_unit(conf_.text_unit);
+
+    if (conf_.reading_from_file &&
+        exot::apps::utilities::is_binary_schedule(conf_.input_file)) {
+      view_ = std::make_unique<exot::apps::utilities::schedule_view>(
+          conf_.input_file, conf_.populate);
+    }
+  }
+
+  bool is_binary() const { return static_cast<bool>(view_); }
+
+  /**
+   * @brief Passes all tokens in order to a callable
+   *
+   * @param  emit    The callable receiving tokens
+   * @param  stopped A callable returning true if playback should end early
+   * @return The number of emitted tokens
+   */
+  template <typename Emit, typename Stopped>
+  std::uint64_t play(Emit&& emit, Stopped&& stopped) {
+    return view_ ? play_binary(emit, stopped) : play_text(emit, stopped);
+  }
+
+ private:
+  /**
+   * @brief Plays back a mapped binary schedule
+   * @details The kernel read-ahead is requested for the next batch of
+   *          records whenever the cursor reaches the middle of the current
+   *          batch, so the playback does not wait on page faults.
+   */
+  template <typename Emit, typename Stopped>
+  std::uint64_t play_binary(Emit& emit, Stopped& stopped) {
+    const auto& view = *view_;
+    const auto distance = std::max<std::size_t>(conf_.prefetch_distance, 1);
+
+    view.prefetch(0, distance);
+    auto prefetched = distance;
+
+    std::size_t i = 0;
+    for (; i < view.size() && !stopped(); ++i) {
+      if (i + distance / 2 >= prefetched) {
+        view.prefetch(prefetched, distance);
+        prefetched += distance;
+      }
+
+      emit(make_token(view[i].duration,
+                      exot::apps::utilities::to_subtoken<subtoken_type>(
+                          view[i].payload)));
+    }
+
+    return i;
+  }
+
+  /**
+   * @brief Plays back a text schedule
+   * @details Subtokens are parsed as the subtoken type, e.g. "1010" is a
+   *          number for integral subtokens and four bits for a bitset.
+   */
+  template <typename Emit, typename Stopped>
+  std::uint64_t play_text(Emit& emit, Stopped& stopped) {
+    std::ifstream file;
+    if (conf_.reading_from_file) {
+      file.open(conf_.input_file);
+      if (!file)
+        throw std::runtime_error("failed to open " + conf_.input_file);
+    }
+
+    std::istream& input = conf_.reading_from_file ? file : std::cin;
+    std::string line;
+    auto count = std::uint64_t{0};
+
+    while (!stopped() && std::getline(input, line)) {
+      auto record = exot::apps::utilities::split_schedule_line(line, unit_);
+      if (!record) continue;
+
+      subtoken_type subtoken;
+      try {
+        subtoken = exot::apps::utilities::parse_subtoken<subtoken_type>(
+            record->payload, conf_.read_as_hex);
+      } catch (const std::exception&) {
+        throw std::invalid_argument("malformed schedule line: " + line);
+      }
+
+      emit(make_token(record->duration, std::move(subtoken)));
+      ++count;
+    }
+
+    return count;
+  }
+
+  static token_type make_token(std::int64_t duration,
+                               subtoken_type&& subtoken) {
+    return token_type{std::chrono::duration_cast<duration_type>(
+                          std::chrono::nanoseconds{duration}),
+                      std::move(subtoken)};
+  }
+
+  const schedule_reader_settings& conf_;
+  double unit_{1.0};
+  std::unique_ptr<exot::apps::utilities::schedule_view> view_;
+};
+
+/**
+ * @brief A schedule reader for binary and text schedules
+ *
+ * @tparam Token The token type, a tuple of a duration and a subtoken
+ */
+template <typename Token>
+class schedule_reader_mmap : public exot::framework::IProcess,
+                             public exot::framework::Producer<Token> {
+ public:
+  using node_type      = exot::framework::Producer<Token>;
+  using token_type     = Token;
+  using settings       = schedule_reader_settings;
+  using state_type     = exot::framework::State;
+  using state_pointer  = std::shared_ptr<state_type>;
+  using logger_pointer = std::shared_ptr<spdlog::logger>;
+
+  explicit schedule_reader_mmap(settings& conf)
+      : conf_{conf},
+        source_{conf_},
+        global_state_{exot::framework::GLOBAL_STATE->get()} {}
+
+  void process() override {
+    if (conf_.cpu_to_pin.has_value())
+      exot::utilities::ThreadTraits::set_affinity(conf_.cpu_to_pin.value());
+
+    debug_log_->info("[schedule_reader_mmap] running on {}, input: {} ({})",
+                     exot::utilities::thread_info(),
+                     conf_.reading_from_file ? conf_.input_file : "stdin",
+                     source_.is_binary() ? "binary" : "text");
+
+    auto count = source_.play(
+        [this](token_type&& token) { this->out_.write(std::move(token)); },
+        [this]() { return global_state_->is_stopped(); });
+
+    debug_log_->info("[schedule_reader_mmap] produced {} tokens", count);
+    global_state_->stop();
+  }
+
+ private:
+  settings conf_;
+  schedule_source<token_type> source_;
+  state_pointer global_state_;
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::components
@@ -0,0 +1,261 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/generators/cache_evict.h
+ * @author     Bruno Klopott
+ * @brief      A generator evicting groups of last-level cache sets.
+ *
+ * The subtoken is a bitmask of 64 consecutive cache set groups, as measured
+ * by the cache_er meter module. While a bit is set, the worker repeatedly
+ * reads the lines of the group at offsets congruent to (j * 64) modulo
+ * set_stride in its buffer, evicting other lines from the same sets.
+ *
+ * With "eviction_sets" enabled, the lines of each group are a minimal
+ * eviction set, loaded from the "eviction_cache" directory where an earlier
+ * run obtained the same hugepages, and constructed on the first token that
+ * uses the group otherwise. A minimal set lies in a single last-level cache
+ * slice, which depends on the physical pages of the buffer, so the setting
+ * must match that of the cache_er meter: with strided lines on one side and
+ * a minimal set on the other, or minimal sets in different slices, the
+ * groups do not contend.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/primitives/cache.h>
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/eviction_sets.h>
+#include <exot/apps/utilities/node_memory.h>
+
+namespace exot::apps::generators {
+
+class generator_cache_evict {
+ public:
+  using subtoken_type    = std::uint64_t;
+  using decomposed_type  = std::uint64_t;
+  using core_type        = unsigned;
+  using index_type       = unsigned;
+  using enable_flag_type = std::atomic<bool>;
+  using logger_pointer   = std::shared_ptr<spdlog::logger>;
+
+  static constexpr std::size_t line_size = 64;
+  static constexpr std::size_t groups    = 64;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    unsigned ways{16u};
+    unsigned set_stride{1u << 17};
+    bool hugepages{true};
+    unsigned hugepage_size{2u << 20};
+    bool eviction_sets{false};
+    unsigned candidates{0u};
+    std::string eviction_cache{};
+    unsigned eviction_threshold{0u};
+
+    const char* name() const { return "generator"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      bind_and_describe_data("ways", ways,
+                             "lines accessed per cache set |uint|, e.g. the "
+                             "associativity, 16");
+      bind_and_describe_data(
+          "set_stride", set_stride,
+          "distance between lines mapping to the same set |uint, bytes|, "
+          "e.g. 131072 for 2048 sets");
+      bind_and_describe_data("hugepages", hugepages,
+                             "back the buffers with hugepages? |bool|");
+      bind_and_describe_data("hugepage_size", hugepage_size,
+                             "hugepage size |uint, bytes|, e.g. 2097152");
+      bind_and_describe_data(
+          "eviction_sets", eviction_sets,
+          "use minimal eviction sets instead of strided lines? |bool|, "
+          "x86_64 only, must match the meter's setting");
+      bind_and_describe_data(
+          "candidates", candidates,
+          "candidate lines per group for the construction |uint|, 8 times "
+          "the ways if 0");
+      bind_and_describe_data(
+          "eviction_cache", eviction_cache,
+          "directory caching constructed sets |str|, no caching if empty");
+      bind_and_describe_data(
+          "eviction_threshold", eviction_threshold,
+          "load latency above which a load misses |uint, cycles|, "
+          "calibrated if 0");
+    }
+  };
+
+  explicit generator_cache_evict(settings& conf) : conf_{conf} {
+    if (conf_.ways == 0)
+      throw std::logic_error("conf->ways must be positive");
+    if (conf_.set_stride < groups * line_size ||
+        conf_.set_stride % line_size != 0)
+      throw std::logic_error(
+          "conf->set_stride must be a multiple of the line size and span "
+          "all set groups");
+
+    if (conf_.eviction_sets && conf_.candidates == 0)
+      conf_.candidates = 8 * conf_.ways;
+    if (conf_.eviction_sets && conf_.candidates <= conf_.ways)
+      throw std::logic_error("conf->candidates must exceed the ways");
+    if (conf_.eviction_sets &&
+        !exot::apps::utilities::eviction_sets_supported)
+      throw std::logic_error(
+          "conf->eviction_sets is only supported on x86_64");
+  }
+
+  ~generator_cache_evict() {
+    debug_log_->info("[generator_cache_evict] {} set accesses",
+                     accesses_.load());
+  }
+
+  bool validate_subtoken(const subtoken_type&) const { return true; }
+
+  decomposed_type decompose_subtoken(const subtoken_type& subtoken,
+                                     core_type, index_type) {
+    return subtoken;
+  }
+
+  void generate_load(const decomposed_type& mask,
+                     const enable_flag_type& flag, core_type core,
+                     index_type index) {
+    thread_local worker_state state;
+    if (!state.buffer) allocate(state, core, index);
+
+    if (mask == 0) return;
+    if ((mask & ~state.ready) != 0) prepare(state, mask & ~state.ready);
+
+    auto* base = state.buffer->data();
+    auto count = std::uint64_t{0};
+
+    while (flag.load(std::memory_order_acquire)) {
+      for (auto remaining = mask; remaining != 0; remaining &= remaining - 1) {
+        const auto& lines = state.sets[__builtin_ctzll(remaining)];
+        for (auto offset : lines)
+          exot::primitives::access_read<>(base + offset);
+        ++count;
+      }
+    }
+
+    accesses_.fetch_add(count, std::memory_order_relaxed);
+  }
+
+ private:
+  struct worker_state {
+    std::unique_ptr<exot::apps::utilities::node_buffer> buffer;
+    std::unique_ptr<exot::apps::utilities::eviction_set_store> store;
+    std::array<exot::apps::utilities::eviction_set, groups> sets;
+    std::uint64_t ready{0};  //! mask of groups with prepared sets
+  };
+
+  void allocate(worker_state& state, core_type core, index_type index) {
+    namespace utl = exot::apps::utilities;
+
+    auto lines   = conf_.eviction_sets ? conf_.candidates : conf_.ways;
+    state.buffer = std::make_unique<utl::node_buffer>(
+        std::size_t{conf_.set_stride} * lines, -1, conf_.hugepages,
+        conf_.hugepage_size);
+
+    debug_log_->debug(
+        "[generator_cache_evict] worker {} on core {}: {} bytes, hugetlb: {}",
+        index, core, state.buffer->size(), state.buffer->is_huge());
+
+    if (!conf_.eviction_sets) return;
+
+    state.store = std::make_unique<utl::eviction_set_store>(
+        state.buffer->data(), state.buffer->size(),
+        state.buffer->is_huge() ? conf_.hugepage_size : 4096u,
+        conf_.set_stride, conf_.ways, conf_.eviction_threshold,
+        conf_.eviction_cache);
+
+    if (conf_.eviction_cache.empty()) return;
+
+    if (auto* cache = state.store->cache()) {
+      debug_log_->info(
+          "[generator_cache_evict] worker {}: {} cached sets in {}", index,
+          cache->size(), cache->path());
+    } else {
+      debug_log_->warn(
+          "[generator_cache_evict] physical addresses are unavailable, "
+          "eviction sets will not be cached");
+    }
+  }
+
+  /**
+   * @brief Prepares the lines of set groups, falling back to strided lines
+   *        if no eviction set is found
+   */
+  void prepare(worker_state& state, std::uint64_t mask) {
+    for (auto remaining = mask; remaining != 0; remaining &= remaining - 1) {
+      auto group  = static_cast<std::uint32_t>(__builtin_ctzll(remaining));
+      auto target = group * static_cast<std::uint32_t>(line_size);
+      auto& lines = state.sets[group];
+
+      if (state.store) {
+        auto found = state.store->get(target);
+        if (found) {
+          lines = std::move(*found);
+        } else {
+          debug_log_->warn(
+              "[generator_cache_evict] no eviction set found for group {}, "
+              "using strided lines",
+              group);
+        }
+      }
+
+      if (lines.empty())
+        lines = exot::apps::utilities::strided_set(target, conf_.set_stride,
+                                                   conf_.ways);
+    }
+
+    state.ready |= mask;
+    if (state.store && !state.store->save())
+      debug_log_->warn("[generator_cache_evict] failed to write {}",
+                       state.store->cache()->path());
+  }
+
+  settings conf_;
+  std::atomic<std::uint64_t> accesses_{0};
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::generators
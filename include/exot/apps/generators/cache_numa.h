@@ -0,0 +1,354 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/generators/cache_numa.h
+ * @author     Bruno Klopott
+ * @brief      A multi-threaded, NUMA-aware generator accessing groups of
+ *             last-level cache sets.
+ *
+ * The subtoken is a bitmask of 64 consecutive cache set groups. Bit j
+ * selects the lines at offsets (j * 64 + k * set_stride) in a worker's
+ * buffer, for k below "ways", which map to the same cache set as long as
+ * set_stride is a multiple of the number of sets times the line size.
+ *
+ * The selected groups are partitioned among the workers on the same NUMA
+ * node, such that each socket's last-level cache is targeted by all of its
+ * workers without duplicated accesses. Every worker accesses its own
+ * buffer, bound to its node and backed by hugepages where available, with
+ * an access pattern chosen per worker from "patterns": "read", "write",
+ * "evict" (flush the lines), or "prefetch".
+ *
+ * With "eviction_sets" enabled, the lines of each group are instead a
+ * minimal eviction set constructed among "candidates" lines at the same
+ * offset modulo set_stride, which accounts for sliced last-level caches.
+ * Constructed sets are cached in the "eviction_cache" directory, keyed by
+ * the CPU model and the physical pages of the buffer, and loaded by later
+ * runs which obtain the same hugepages.
+ *
+ * Buffers are allocated by the workers on their first token, and eviction
+ * sets are constructed on the first token using a group. A leading token
+ * selecting all groups moves both out of the measurement.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/primitives/cache.h>
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/eviction_sets.h>
+#include <exot/apps/utilities/node_memory.h>
+
+namespace exot::apps::generators {
+
+class generator_cache_numa {
+ public:
+  using subtoken_type    = std::uint64_t;
+  using decomposed_type  = std::uint64_t;
+  using core_type        = unsigned;
+  using index_type       = unsigned;
+  using enable_flag_type = std::atomic<bool>;
+  using logger_pointer   = std::shared_ptr<spdlog::logger>;
+
+  static constexpr std::size_t max_workers = 256;
+  static constexpr std::size_t line_size   = 64;
+  static constexpr std::size_t groups      = 64;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::vector<std::string> patterns{"read"};
+    unsigned ways{16u};
+    unsigned set_stride{1u << 17};
+    bool hugepages{true};
+    unsigned hugepage_size{2u << 20};
+    bool eviction_sets{false};
+    unsigned candidates{0u};
+    std::string eviction_cache{};
+    unsigned eviction_threshold{0u};
+
+    const char* name() const { return "generator"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      bind_and_describe_data(
+          "patterns", patterns,
+          "access pattern per worker |str[]|, \"read\", \"write\", "
+          "\"evict\" or \"prefetch\", repeated if shorter than the cores");
+      bind_and_describe_data("ways", ways,
+                             "lines accessed per cache set |uint|, e.g. the "
+                             "associativity, 16");
+      bind_and_describe_data(
+          "set_stride", set_stride,
+          "distance between lines mapping to the same set |uint, bytes|, "
+          "e.g. 131072 for 2048 sets");
+      bind_and_describe_data("hugepages", hugepages,
+                             "back the buffers with hugepages? |bool|");
+      bind_and_describe_data("hugepage_size", hugepage_size,
+                             "hugepage size |uint, bytes|, e.g. 2097152");
+      bind_and_describe_data(
+          "eviction_sets", eviction_sets,
+          "construct minimal eviction sets instead of strided lines? |bool|");
+      bind_and_describe_data(
+          "candidates", candidates,
+          "candidate lines per group for the construction |uint|, 8 times "
+          "the ways if 0");
+      bind_and_describe_data(
+          "eviction_cache", eviction_cache,
+          "directory caching constructed sets |str|, no caching if empty");
+      bind_and_describe_data(
+          "eviction_threshold", eviction_threshold,
+          "load latency above which a load misses |uint, cycles|, "
+          "calibrated if 0");
+    }
+  };
+
+  explicit generator_cache_numa(settings& conf) : conf_{conf} {
+    if (conf_.patterns.empty())
+      throw std::logic_error("conf->patterns must not be empty");
+    for (const auto& pattern : conf_.patterns) parse_pattern(pattern);
+
+    if (conf_.ways == 0)
+      throw std::logic_error("conf->ways must be positive");
+    if (conf_.set_stride < groups * line_size ||
+        conf_.set_stride % line_size != 0)
+      throw std::logic_error(
+          "conf->set_stride must be a multiple of the line size and span "
+          "all set groups");
+
+    if (conf_.eviction_sets && conf_.candidates == 0)
+      conf_.candidates = 8 * conf_.ways;
+    if (conf_.eviction_sets && conf_.candidates <= conf_.ways)
+      throw std::logic_error("conf->candidates must exceed the ways");
+    if (conf_.eviction_sets &&
+        !exot::apps::utilities::eviction_sets_supported)
+      throw std::logic_error(
+          "conf->eviction_sets is only supported on x86_64");
+
+    cores_.fill(unregistered);
+  }
+
+  ~generator_cache_numa() {
+    debug_log_->info("[generator_cache_numa] {} set accesses",
+                     accesses_.load());
+  }
+
+  bool validate_subtoken(const subtoken_type&) const { return true; }
+
+  /**
+   * @brief Registers the worker and passes the full mask through
+   * @details The partitioning among workers requires all workers to be
+   *          known, and is therefore done when the load is generated.
+   */
+  decomposed_type decompose_subtoken(const subtoken_type& subtoken,
+                                     core_type core, index_type index) {
+    if (index >= max_workers)
+      throw std::out_of_range("generator_cache_numa supports 256 workers");
+
+    if (cores_[index] == unregistered) {
+      cores_[index] = core;
+      nodes_[index] = exot::apps::utilities::node_of(core);
+      workers_      = std::max<std::size_t>(workers_, index + 1);
+    }
+
+    return subtoken;
+  }
+
+  void generate_load(const decomposed_type& subtoken,
+                     const enable_flag_type& flag, core_type core,
+                     index_type index) {
+    thread_local worker_state state;
+    if (!state.buffer) allocate(state, core, index);
+
+    auto mask = subtoken & partition(index);
+    if (mask == 0) return;
+    if ((mask & ~state.ready) != 0) prepare(state, mask & ~state.ready);
+
+    auto pattern = parse_pattern(
+        conf_.patterns[index % conf_.patterns.size()]);
+    auto* base = state.buffer->data();
+    auto count = std::uint64_t{0};
+
+    while (flag.load(std::memory_order_acquire)) {
+      for (auto remaining = mask; remaining != 0; remaining &= remaining - 1) {
+        const auto& lines = state.sets[__builtin_ctzll(remaining)];
+        for (auto offset : lines) access(pattern, base + offset);
+        ++count;
+      }
+    }
+
+    accesses_.fetch_add(count, std::memory_order_relaxed);
+  }
+
+ private:
+  enum class pattern_type { read, write, evict, prefetch };
+
+  struct worker_state {
+    std::unique_ptr<exot::apps::utilities::node_buffer> buffer;
+    std::unique_ptr<exot::apps::utilities::eviction_set_store> store;
+    std::array<exot::apps::utilities::eviction_set, groups> sets;
+    std::uint64_t ready{0};  //! mask of groups with prepared sets
+  };
+
+  static constexpr unsigned unregistered = ~0u;
+
+  static pattern_type parse_pattern(const std::string& name) {
+    if (name == "read") return pattern_type::read;
+    if (name == "write") return pattern_type::write;
+    if (name == "evict") return pattern_type::evict;
+    if (name == "prefetch") return pattern_type::prefetch;
+    throw std::logic_error("unknown access pattern: " + name);
+  }
+
+  static inline void access(pattern_type pattern, std::uint8_t* address) {
+    switch (pattern) {
+      case pattern_type::read:
+        exot::primitives::access_read<>(address);
+        break;
+      case pattern_type::write:
+        *reinterpret_cast<volatile std::uint8_t*>(address) += 1;
+        break;
+      case pattern_type::evict:
+        exot::primitives::flush(address);
+        break;
+      case pattern_type::prefetch:
+        exot::primitives::prefetch(address);
+        break;
+    }
+  }
+
+  void allocate(worker_state& state, core_type core, index_type index) {
+    namespace utl = exot::apps::utilities;
+
+    auto lines   = conf_.eviction_sets ? conf_.candidates : conf_.ways;
+    state.buffer = std::make_unique<utl::node_buffer>(
+        std::size_t{conf_.set_stride} * lines,
+        static_cast<int>(nodes_[index]), conf_.hugepages,
+        conf_.hugepage_size);
+
+    debug_log_->debug(
+        "[generator_cache_numa] worker {} on core {}, node {}: {} bytes, "
+        "hugetlb: {}, bound: {}",
+        index, core, nodes_[index], state.buffer->size(),
+        state.buffer->is_huge(), state.buffer->is_bound());
+
+    if (!conf_.eviction_sets) return;
+
+    state.store = std::make_unique<utl::eviction_set_store>(
+        state.buffer->data(), state.buffer->size(),
+        state.buffer->is_huge() ? conf_.hugepage_size : 4096u,
+        conf_.set_stride, conf_.ways, conf_.eviction_threshold,
+        conf_.eviction_cache);
+
+    if (conf_.eviction_cache.empty()) return;
+
+    if (auto* cache = state.store->cache()) {
+      debug_log_->info("[generator_cache_numa] worker {}: {} cached sets in {}",
+                       index, cache->size(), cache->path());
+    } else {
+      debug_log_->warn(
+          "[generator_cache_numa] physical addresses are unavailable, "
+          "eviction sets will not be cached");
+    }
+  }
+
+  /**
+   * @brief Prepares the lines of set groups
+   * @details Uses strided lines, or cached or newly constructed eviction
+   *          sets, falling back to strided lines if construction fails.
+   */
+  void prepare(worker_state& state, std::uint64_t mask) {
+    for (auto remaining = mask; remaining != 0; remaining &= remaining - 1) {
+      auto group  = static_cast<std::uint32_t>(__builtin_ctzll(remaining));
+      auto target = group * static_cast<std::uint32_t>(line_size);
+      auto& lines = state.sets[group];
+
+      if (state.store) {
+        auto found = state.store->get(target);
+        if (found) {
+          lines = std::move(*found);
+        } else {
+          debug_log_->warn(
+              "[generator_cache_numa] no eviction set found for group {}, "
+              "using strided lines",
+              group);
+        }
+      }
+
+      if (lines.empty())
+        lines = exot::apps::utilities::strided_set(target, conf_.set_stride,
+                                                   conf_.ways);
+    }
+
+    state.ready |= mask;
+    if (state.store && !state.store->save())
+      debug_log_->warn("[generator_cache_numa] failed to write {}",
+                       state.store->cache()->path());
+  }
+
+  /**
+   * @brief Gets the set groups assigned to a worker
+   * @details Groups are dealt round-robin to the workers on the same node,
+   *          in the order of their indices.
+   */
+  std::uint64_t partition(index_type index) const {
+    auto rank = 0u, peers = 0u;
+    for (std::size_t i = 0; i < workers_; ++i) {
+      if (cores_[i] == unregistered || nodes_[i] != nodes_[index]) continue;
+      if (i < index) ++rank;
+      ++peers;
+    }
+
+    auto mask = std::uint64_t{0};
+    for (auto group = rank; group < groups; group += peers)
+      mask |= std::uint64_t{1} << group;
+    return mask;
+  }
+
+  settings conf_;
+  std::array<unsigned, max_workers> cores_;
+  std::array<unsigned, max_workers> nodes_{};
+  std::size_t workers_{0};
+  std::atomic<std::uint64_t> accesses_{0};
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::generators
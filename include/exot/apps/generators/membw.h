@@ -0,0 +1,229 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/generators/membw.h
+ * @author     Bruno Klopott
+ * @brief      A multi-threaded generator imposing streaming memory bandwidth.
+ *
+ * The subtoken is the bandwidth imposed by each worker in MiB/s, 0 leaving
+ * the worker idle. Every worker streams through its own buffer, bound to
+ * its NUMA node and larger than the last-level cache, with an access
+ * pattern chosen per worker from "patterns": "read", "write" (non-temporal
+ * stores), or "copy" (loads from one half of the buffer and non-temporal
+ * stores to the other).
+ *
+ * The buffer is processed in chunks of "chunk_size" bytes. After each chunk
+ * the worker waits until the time at which the streamed bytes match the
+ * target bandwidth, such that targets above the achievable bandwidth run
+ * unthrottled. Buffers are allocated by the workers on their first token.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/deadline.h>
+#include <exot/apps/utilities/memory_streams.h>
+#include <exot/apps/utilities/node_memory.h>
+
+namespace exot::apps::generators {
+
+class generator_membw {
+ public:
+  using subtoken_type    = unsigned;
+  using decomposed_type  = unsigned;
+  using core_type        = unsigned;
+  using index_type       = unsigned;
+  using enable_flag_type = std::atomic<bool>;
+  using logger_pointer   = std::shared_ptr<spdlog::logger>;
+
+  static constexpr std::size_t line_size = 64;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::vector<std::string> patterns{"read"};
+    unsigned buffer_size{256u << 20};
+    unsigned chunk_size{256u << 10};
+    bool hugepages{true};
+    unsigned hugepage_size{2u << 20};
+
+    const char* name() const { return "generator"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      bind_and_describe_data(
+          "patterns", patterns,
+          "access pattern per worker |str[]|, \"read\", \"write\" or "
+          "\"copy\", repeated if shorter than the cores");
+      bind_and_describe_data(
+          "buffer_size", buffer_size,
+          "buffer size per worker |uint, bytes|, well above the LLC size");
+      bind_and_describe_data(
+          "chunk_size", chunk_size,
+          "bytes streamed between throttling checks |uint, bytes|, e.g. "
+          "262144");
+      bind_and_describe_data("hugepages", hugepages,
+                             "back the buffers with hugepages? |bool|");
+      bind_and_describe_data("hugepage_size", hugepage_size,
+                             "hugepage size |uint, bytes|, e.g. 2097152");
+    }
+  };
+
+  explicit generator_membw(settings& conf) : conf_{conf} {
+    if (conf_.patterns.empty())
+      throw std::logic_error("conf->patterns must not be empty");
+    for (const auto& pattern : conf_.patterns) parse_pattern(pattern);
+
+    if (conf_.chunk_size == 0 || conf_.chunk_size % (2 * line_size) != 0)
+      throw std::logic_error(
+          "conf->chunk_size must be a positive multiple of 128 bytes");
+    if (conf_.buffer_size < 2 * conf_.chunk_size)
+      throw std::logic_error(
+          "conf->buffer_size must hold at least two chunks");
+
+    conf_.buffer_size -= conf_.buffer_size % (2 * conf_.chunk_size);
+  }
+
+  ~generator_membw() {
+    debug_log_->info("[generator_membw] {} MiB streamed",
+                     streamed_.load() >> 20);
+  }
+
+  bool validate_subtoken(const subtoken_type&) const { return true; }
+
+  decomposed_type decompose_subtoken(const subtoken_type& subtoken,
+                                     core_type, index_type) {
+    return subtoken;
+  }
+
+  void generate_load(const decomposed_type& target,
+                     const enable_flag_type& flag, core_type core,
+                     index_type index) {
+    namespace utl = exot::apps::utilities;
+
+    thread_local std::unique_ptr<utl::node_buffer> buffer;
+    thread_local std::size_t position{0};
+
+    if (target == 0) return;
+    if (!buffer) buffer = allocate(core, index);
+
+    auto pattern = parse_pattern(
+        conf_.patterns[index % conf_.patterns.size()]);
+    auto* data   = buffer->data();
+    auto size    = std::size_t{conf_.buffer_size};
+    auto chunk   = std::size_t{conf_.chunk_size};
+    auto half    = size / 2;
+
+    /* Nanoseconds per streamed byte at the target bandwidth. */
+    auto ns_per_byte = 1e9 / (static_cast<double>(target) * (1u << 20));
+    auto start       = utl::monotonic_ns();
+    auto streamed    = std::uint64_t{0};
+    auto sink        = std::uint64_t{0};
+
+    while (flag.load(std::memory_order_acquire)) {
+      switch (pattern) {
+        case pattern_type::read:
+          sink += utl::stream_read(data + position, chunk);
+          position = (position + chunk) % size;
+          break;
+        case pattern_type::write:
+          utl::stream_write(data + position, chunk, streamed);
+          position = (position + chunk) % size;
+          break;
+        case pattern_type::copy:
+          position %= half;
+          utl::stream_copy(data + half + position, data + position, chunk);
+          position = (position + chunk) % half;
+          break;
+      }
+
+      streamed += chunk;
+
+      auto due = start + static_cast<std::int64_t>(streamed * ns_per_byte);
+      while (flag.load(std::memory_order_acquire)) {
+        auto now = utl::monotonic_ns();
+        if (now >= due) break;
+        utl::wait_until_ns(std::min(due, now + max_wait), 0);
+      }
+    }
+
+    streamed_.fetch_add(streamed, std::memory_order_relaxed);
+    sink_.fetch_xor(sink, std::memory_order_relaxed);
+  }
+
+ private:
+  enum class pattern_type { read, write, copy };
+
+  /* Longest uninterrupted wait, bounding the reaction to deactivation. */
+  static constexpr std::int64_t max_wait = 100000;
+
+  static pattern_type parse_pattern(const std::string& name) {
+    if (name == "read") return pattern_type::read;
+    if (name == "write") return pattern_type::write;
+    if (name == "copy") return pattern_type::copy;
+    throw std::logic_error("unknown access pattern: " + name);
+  }
+
+  std::unique_ptr<exot::apps::utilities::node_buffer> allocate(
+      core_type core, index_type index) {
+    auto node   = exot::apps::utilities::node_of(core);
+    auto buffer = std::make_unique<exot::apps::utilities::node_buffer>(
+        conf_.buffer_size, static_cast<int>(node), conf_.hugepages,
+        conf_.hugepage_size);
+
+    debug_log_->debug(
+        "[generator_membw] worker {} on core {}, node {}: {} bytes, "
+        "hugetlb: {}, bound: {}",
+        index, core, node, buffer->size(), buffer->is_huge(),
+        buffer->is_bound());
+
+    return buffer;
+  }
+
+  settings conf_;
+  std::atomic<std::uint64_t> streamed_{0};
+  std::atomic<std::uint64_t> sink_{0};
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::generators
@@ -0,0 +1,371 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/generators/power_target.h
+ * @author     Bruno Klopott
+ * @brief      A closed-loop generator holding a target package power.
+ *
+ * Each subtoken specifies a target power in watts, 0 meaning no load. All
+ * workers run a load kernel for a fraction ("duty") of every control period
+ * and sleep for the rest. The first worker also acts as the controller: at
+ * the end of every period it reads the power through a meter module, e.g.
+ * exot::apps::modules::power_msr, and updates the shared duty with a PI
+ * controller. The controlled power is the sum of the meter's channels
+ * selected by "power_channel", by default all packages. When the duty stays
+ * saturated, the workers switch to a heavier kernel from the "kernels"
+ * ladder, and to a lighter one when the duty stays low, such that targets
+ * can be held across a wide power range.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/channels.h>
+#include <exot/apps/utilities/deadline.h>
+#include <exot/apps/utilities/duty_cycle.h>
+#include <exot/apps/utilities/load_kernels.h>
+#include <exot/apps/utilities/pi_controller.h>
+
+namespace exot::apps::generators {
+
+/**
+ * @brief A generator controlling the load to hold a target power
+ *
+ * @tparam PowerMeter The meter module providing the power readings
+ */
+template <typename PowerMeter>
+class generator_power_target {
+ public:
+  using subtoken_type    = unsigned;
+  using decomposed_type  = double;
+  using core_type        = unsigned;
+  using index_type       = unsigned;
+  using enable_flag_type = std::atomic<bool>;
+  using logger_pointer   = std::shared_ptr<spdlog::logger>;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::vector<std::string> kernels{};
+    double control_period{1e-3};
+    double kp{0.01};
+    double ki{0.5};
+    double smoothing{0.3};
+    std::string power_channel{"pkg"};
+    unsigned batch_size{64u};
+    unsigned stream_buffer{32u << 20};
+    unsigned switch_after{50u};
+    double low_duty{0.3};
+
+    typename PowerMeter::settings meter;
+
+    const char* name() const { return "generator"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      this->bind_and_describe_data(
+          "kernels", kernels,
+          "load kernels from lightest to heaviest |str[]|, e.g. "
+          "[\"scalar\", \"avx2\"], all supported vector kernels if empty");
+      this->bind_and_describe_data("control_period", control_period,
+                                   "period of the control loop |s|, "
+                                   "e.g. 1e-3");
+      this->bind_and_describe_data("kp", kp,
+                                   "proportional gain |float, 1/W|");
+      this->bind_and_describe_data("ki", ki, "integral gain |float, 1/Ws|");
+      this->bind_and_describe_data(
+          "smoothing", smoothing,
+          "weight of new power readings in the moving average |float|, in "
+          "range (0, 1]");
+      this->bind_and_describe_data(
+          "power_channel", power_channel,
+          "meter channels summed as the controlled power |str|, a name "
+          "such as \"pkg0\", a prefix of numbered channels such as "
+          "\"pkg\" for all packages, or a channel index");
+      this->bind_and_describe_data(
+          "batch_size", batch_size,
+          "work items executed between time checks |uint|, e.g. 64");
+      this->bind_and_describe_data("stream_buffer", stream_buffer,
+                                   "per-thread buffer of the stream kernel "
+                                   "|uint, bytes|, e.g. 33554432");
+      this->bind_and_describe_data(
+          "switch_after", switch_after,
+          "control periods the duty must stay saturated or low before "
+          "switching kernels |uint|, e.g. 50");
+      this->bind_and_describe_data(
+          "low_duty", low_duty,
+          "duty below which a lighter kernel is chosen |float|, e.g. 0.3");
+
+      meter.set_json(this->get_json());
+      meter.configure();
+    }
+  };
+
+  explicit generator_power_target(settings& conf)
+      : conf_{conf}, controller_{conf_.kp, conf_.ki, 0.0, 1.0} {
+    if (conf_.control_period <= 0.0)
+      throw std::logic_error("conf->control_period must be positive");
+    if (conf_.smoothing <= 0.0 || conf_.smoothing > 1.0)
+      throw std::logic_error("conf->smoothing must be in (0, 1]");
+    if (conf_.batch_size == 0)
+      throw std::logic_error("conf->batch_size must be positive");
+
+    auto names = conf_.kernels;
+    if (names.empty()) {
+      for (auto name : {"scalar", "sse", "avx2", "avx512", "neon"})
+        if (exot::apps::utilities::is_kernel_supported(name))
+          names.emplace_back(name);
+    }
+
+    for (const auto& name : names)
+      kernels_.push_back(exot::apps::utilities::select_kernel(name));
+    if (kernels_.empty())
+      throw std::logic_error("conf->kernels must not be empty");
+
+    if (std::find(names.begin(), names.end(), "stream") != names.end()) {
+      if (conf_.stream_buffer < 64u)
+        throw std::logic_error("conf->stream_buffer must hold a cache line");
+      stream_bytes_ = conf_.stream_buffer;
+    }
+
+    period_ns_ = static_cast<std::int64_t>(conf_.control_period * 1e9);
+    level_.store(kernels_.size() - 1);
+    controller_.reset(duty_.load());
+
+    meter_ = std::make_unique<PowerMeter>(conf_.meter);
+    select_channels();
+
+    debug_log_->info(
+        "[generator_power_target] kernels: {}, control period: {} ns, "
+        "power: sum of {}",
+        fmt::join(names, ", "), period_ns_, fmt::join(channel_names_, ", "));
+  }
+
+  ~generator_power_target() {
+    if (periods_ != 0)
+      debug_log_->info(
+          "[generator_power_target] {} control periods, mean absolute "
+          "error: {:.2f} W",
+          periods_, error_sum_ / periods_);
+  }
+
+  bool validate_subtoken(const subtoken_type&) const { return true; }
+
+  decomposed_type decompose_subtoken(const subtoken_type& subtoken,
+                                     core_type, index_type) const {
+    return static_cast<double>(subtoken);
+  }
+
+  void generate_load(const decomposed_type& target,
+                     const enable_flag_type& flag, core_type,
+                     index_type index) {
+    namespace utl = exot::apps::utilities;
+
+    if (target <= 0.0) return;
+
+    // the context is allocated once per worker, on its first load
+    thread_local utl::kernel_context context{stream_bytes_};
+    const auto is_controller = index == 0;
+    if (is_controller) last_control_ = utl::monotonic_ns();
+
+    utl::run_duty_cycle(
+        flag, period_ns_, conf_.batch_size, context,
+        [this] {
+          return std::make_pair(
+              duty_.load(),
+              kernels_[level_.load(std::memory_order_relaxed)]);
+        },
+        [this, is_controller, target] {
+          if (is_controller) control(target);
+        });
+  }
+
+ private:
+  /**
+   * @brief Reads the power and updates the duty and kernel level
+   */
+  void control(double target) {
+    auto now = exot::apps::utilities::monotonic_ns();
+    auto dt  = static_cast<double>(now - last_control_) * 1e-9;
+    last_control_ = now;
+
+    auto power = read_power();
+    if (!std::isfinite(power)) return;
+
+    const auto alpha = conf_.smoothing;
+    smoothed_ = std::isfinite(smoothed_)
+                    ? alpha * power + (1.0 - alpha) * smoothed_
+                    : power;
+
+    auto error = target - smoothed_;
+    auto duty  = controller_.update(error, dt);
+    error_sum_ += std::fabs(error);
+    ++periods_;
+
+    auto level = level_.load(std::memory_order_relaxed);
+    if (duty >= 0.99 && level + 1 < kernels_.size()) {
+      if (++saturated_ >= conf_.switch_after) {
+        level_.store(level + 1, std::memory_order_relaxed);
+        duty = 0.5;
+        controller_.reset(duty);
+        saturated_ = 0;
+      }
+    } else if (duty <= conf_.low_duty && level > 0) {
+      if (++saturated_ >= conf_.switch_after) {
+        level_.store(level - 1, std::memory_order_relaxed);
+        duty = std::min(1.0, 2.0 * duty);
+        controller_.reset(duty);
+        saturated_ = 0;
+      }
+    } else {
+      saturated_ = 0;
+    }
+
+    duty_.store(duty);
+  }
+
+  /**
+   * @brief Resolves "power_channel" to channel indices of the meter
+   * @details A name selects the channel of that name or, if there is none,
+   *          every channel consisting of the name and a package number,
+   *          e.g. "pkg" selects "pkg0" and "pkg1", and "pp0" selects "pp00"
+   *          and "pp01". Channel names are taken from the meter's header
+   *          without the module prefix.
+   */
+  void select_channels() {
+    const auto& wanted = conf_.power_channel;
+    auto header        = meter_->header();
+
+    auto is_number = [](const std::string& text, std::size_t from) {
+      return from < text.size() &&
+             std::all_of(text.begin() + from, text.end(),
+                         [](char c) { return c >= '0' && c <= '9'; });
+    };
+
+    if (is_number(wanted, 0)) {
+      auto index = static_cast<std::size_t>(std::stoul(wanted));
+      if (index >= header.size())
+        throw std::logic_error(fmt::format(
+            "conf->power_channel {} exceeds the meter's {} channels", index,
+            header.size()));
+      channels_.push_back(index);
+      channel_names_.push_back(header[index]);
+      return;
+    }
+
+    auto select = [&](auto&& matches) {
+      for (std::size_t i = 0; i < header.size(); ++i) {
+        auto name = header[i].substr(header[i].find_last_of(':') + 1);
+        if (matches(name)) {
+          channels_.push_back(i);
+          channel_names_.push_back(header[i]);
+        }
+      }
+    };
+
+    select([&](const std::string& name) { return name == wanted; });
+    if (channels_.empty())
+      select([&](const std::string& name) {
+        return name.compare(0, wanted.size(), wanted) == 0 &&
+               is_number(name, wanted.size());
+      });
+
+    if (channels_.empty())
+      throw std::logic_error(
+          fmt::format("conf->power_channel \"{}\" matches none of: {}",
+                      wanted, fmt::join(header, ", ")));
+  }
+
+  /**
+   * @brief Reads the sum of the selected channels
+   * @return The power, or NaN if a selected channel is missing from the
+   *         reading or is itself NaN, e.g. after a failed read
+   */
+  double read_power() {
+    auto reading = meter_->measure();
+    auto power   = 0.0;
+    auto valid   = true;
+    auto channel = std::size_t{0};
+    auto next    = channels_.begin();
+
+    exot::apps::utilities::visit_channels(reading, [&](auto value) {
+      if (next != channels_.end() && *next == channel) {
+        auto converted = static_cast<double>(value);
+        if (std::isnan(converted)) valid = false;
+        power += converted;
+        ++next;
+      }
+      ++channel;
+    });
+
+    return valid && next == channels_.end()
+               ? power
+               : std::numeric_limits<double>::quiet_NaN();
+  }
+
+  settings conf_;
+  std::unique_ptr<PowerMeter> meter_;
+  std::vector<std::size_t> channels_;  //! summed channels, ascending
+  std::vector<std::string> channel_names_;
+  std::vector<exot::apps::utilities::load_kernel> kernels_;
+  exot::apps::utilities::pi_controller controller_;
+  std::int64_t period_ns_{0};
+  std::size_t stream_bytes_{0};  //! stream buffer, if in the ladder
+
+  std::atomic<double> duty_{0.5};
+  std::atomic<std::size_t> level_{0};
+
+  // only accessed by the controlling worker
+  std::int64_t last_control_{0};
+  double smoothed_{std::numeric_limits<double>::quiet_NaN()};
+  unsigned saturated_{0};
+  double error_sum_{0.0};
+  std::uint64_t periods_{0};
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::generators
@@ -0,0 +1,271 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/generators/thermal_target.h
+ * @author     Bruno Klopott
+ * @brief      A closed-loop generator holding a target temperature.
+ *
+ * Each subtoken specifies a target temperature in degrees Celsius, 0
+ * meaning no load. All workers run a load kernel for a fraction ("duty") of
+ * every "duty_period", and sleep for the rest. The first worker also acts
+ * as the controller: every "control_period" it reads the temperature
+ * through a meter module, e.g. exot::apps::modules::thermal_sysfs or
+ * exot::modules::thermal_msr, and updates the shared duty with a PI
+ * controller with anti-windup. The sensor is only read by the controller,
+ * at the control rate, and the last reading is reused in between. When the
+ * controlled reading is not a number, e.g. because the sensor failed to
+ * read, the duty is held until the next valid reading.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/channels.h>
+#include <exot/apps/utilities/deadline.h>
+#include <exot/apps/utilities/duty_cycle.h>
+#include <exot/apps/utilities/load_kernels.h>
+#include <exot/apps/utilities/pi_controller.h>
+
+namespace exot::apps::generators {
+
+/**
+ * @brief A generator controlling the load to hold a target temperature
+ *
+ * @tparam Sensor The meter module providing the temperature readings
+ */
+template <typename Sensor>
+class generator_thermal_target {
+ public:
+  using subtoken_type    = unsigned;
+  using decomposed_type  = double;
+  using core_type        = unsigned;
+  using index_type       = unsigned;
+  using enable_flag_type = std::atomic<bool>;
+  using logger_pointer   = std::shared_ptr<spdlog::logger>;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::string kernel{"auto"};
+    double duty_period{1e-3};
+    double control_period{0.1};
+    double kp{0.05};
+    double ki{0.01};
+    std::optional<unsigned> sensor_channel{std::nullopt};
+    unsigned batch_size{64u};
+    unsigned stream_buffer{32u << 20};
+
+    typename Sensor::settings sensor;
+
+    const char* name() const { return "generator"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      this->bind_and_describe_data(
+          "kernel", kernel,
+          "load kernel |str|, see generator_utilisation_kernels");
+      this->bind_and_describe_data("duty_period", duty_period,
+                                   "period of the duty cycle |s|, "
+                                   "e.g. 1e-3");
+      this->bind_and_describe_data("control_period", control_period,
+                                   "period of the control loop |s|, "
+                                   "e.g. 0.1");
+      this->bind_and_describe_data("kp", kp,
+                                   "proportional gain |float, 1/degC|");
+      this->bind_and_describe_data("ki", ki,
+                                   "integral gain |float, 1/(degC s)|");
+      this->bind_and_describe_data(
+          "sensor_channel", sensor_channel,
+          "index of the controlled temperature among the sensor's channels "
+          "|uint|, the hottest channel if not set");
+      this->bind_and_describe_data(
+          "batch_size", batch_size,
+          "work items executed between time checks |uint|, e.g. 64");
+      this->bind_and_describe_data("stream_buffer", stream_buffer,
+                                   "per-thread buffer of the stream kernel "
+                                   "|uint, bytes|, e.g. 33554432");
+
+      sensor.set_json(this->get_json());
+      sensor.configure();
+    }
+  };
+
+  explicit generator_thermal_target(settings& conf)
+      : conf_{conf}, controller_{conf_.kp, conf_.ki, 0.0, 1.0} {
+    if (conf_.duty_period <= 0.0)
+      throw std::logic_error("conf->duty_period must be positive");
+    if (conf_.control_period < conf_.duty_period)
+      throw std::logic_error(
+          "conf->control_period must not be below duty_period");
+    if (conf_.batch_size == 0)
+      throw std::logic_error("conf->batch_size must be positive");
+
+    auto name = conf_.kernel == "auto" ? exot::apps::utilities::best_kernel()
+                                       : conf_.kernel;
+    kernel_ = exot::apps::utilities::select_kernel(name);
+
+    if (name == "stream") {
+      if (conf_.stream_buffer < 64u)
+        throw std::logic_error("conf->stream_buffer must hold a cache line");
+      stream_bytes_ = conf_.stream_buffer;
+    }
+
+    duty_ns_    = static_cast<std::int64_t>(conf_.duty_period * 1e9);
+    control_ns_ = static_cast<std::int64_t>(conf_.control_period * 1e9);
+
+    sensor_ = std::make_unique<Sensor>(conf_.sensor);
+
+    debug_log_->info(
+        "[generator_thermal_target] kernel: {}, duty period: {} ns, control "
+        "period: {} ns",
+        name, duty_ns_, control_ns_);
+  }
+
+  ~generator_thermal_target() {
+    if (updates_ != 0)
+      debug_log_->info(
+          "[generator_thermal_target] {} control updates, last temperature: "
+          "{:.1f} degC, mean absolute error: {:.2f} degC",
+          updates_, temperature_, error_sum_ / updates_);
+    if (failed_reads_ != 0)
+      debug_log_->warn(
+          "[generator_thermal_target] duty held on {} invalid readings",
+          failed_reads_);
+  }
+
+  bool validate_subtoken(const subtoken_type&) const { return true; }
+
+  decomposed_type decompose_subtoken(const subtoken_type& subtoken,
+                                     core_type, index_type) const {
+    return static_cast<double>(subtoken);
+  }
+
+  void generate_load(const decomposed_type& target,
+                     const enable_flag_type& flag, core_type,
+                     index_type index) {
+    namespace utl = exot::apps::utilities;
+
+    if (target <= 0.0) return;
+
+    // the context is allocated once per worker, on its first load
+    thread_local utl::kernel_context context{stream_bytes_};
+    const auto is_controller = index == 0;
+    if (is_controller) {
+      last_control_ = utl::monotonic_ns();
+      control(target, 0.0);
+    }
+
+    utl::run_duty_cycle(
+        flag, duty_ns_, conf_.batch_size, context,
+        [this] { return std::make_pair(duty_.load(), kernel_); },
+        [this, is_controller, target] {
+          if (!is_controller) return;
+
+          auto now = utl::monotonic_ns();
+          if (now - last_control_ < control_ns_) return;
+
+          auto dt       = static_cast<double>(now - last_control_) * 1e-9;
+          last_control_ = now;
+          control(target, dt);
+        });
+  }
+
+ private:
+  /**
+   * @brief Reads the temperature and updates the duty
+   */
+  void control(double target, double dt) {
+    auto temperature = read_temperature();
+    if (!std::isfinite(temperature)) {
+      ++failed_reads_;
+      return;
+    }
+    temperature_ = temperature;
+
+    auto error = target - temperature;
+    duty_.store(controller_.update(error, dt));
+
+    error_sum_ += std::fabs(error);
+    ++updates_;
+  }
+
+  double read_temperature() {
+    auto reading = sensor_->measure();
+    auto result  = std::numeric_limits<double>::quiet_NaN();
+    auto channel = 0u;
+
+    exot::apps::utilities::visit_channels(reading, [&](auto value) {
+      auto current = static_cast<double>(value);
+      if (conf_.sensor_channel.has_value()) {
+        if (channel == conf_.sensor_channel.value()) result = current;
+      } else if (std::isfinite(current) && !(current <= result)) {
+        result = current;
+      }
+      ++channel;
+    });
+
+    return result;
+  }
+
+  settings conf_;
+  std::unique_ptr<Sensor> sensor_;
+  exot::apps::utilities::load_kernel kernel_;
+  exot::apps::utilities::pi_controller controller_;
+  std::int64_t duty_ns_{0};
+  std::int64_t control_ns_{0};
+  std::size_t stream_bytes_{0};  //! stream buffer, if the stream kernel
+
+  std::atomic<double> duty_{0.0};
+
+  // only accessed by the controlling worker
+  std::int64_t last_control_{0};
+  double temperature_{std::numeric_limits<double>::quiet_NaN()};
+  double error_sum_{0.0};
+  std::uint64_t updates_{0};
+  std::uint64_t failed_reads_{0};
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::generators
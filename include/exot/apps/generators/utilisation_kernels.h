@@ -0,0 +1,140 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/generators/utilisation_kernels.h
+ * @author     Bruno Klopott
+ * @brief      A multi-threaded utilisation generator with selectable load
+ *             kernels.
+ *
+ * Unlike the scalar busy loop of the library's utilisation generators, the
+ * load is produced by a kernel chosen from the JSON configuration: "scalar",
+ * "sse", "avx2", "avx512", "neon", "stream", or "auto" for the widest vector
+ * kernel supported by the CPU. Kernels run in batches of "batch_size" work
+ * items between checks of the enable flag.
+ *
+ * The subtoken is a bitmask of the workers to load, bit i corresponding to
+ * the i-th entry in the host's "cores".
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/load_kernels.h>
+
+namespace exot::apps::generators {
+
+class generator_utilisation_kernels {
+ public:
+  using subtoken_type    = std::uint64_t;
+  using decomposed_type  = bool;
+  using core_type        = unsigned;
+  using index_type       = unsigned;
+  using enable_flag_type = std::atomic<bool>;
+  using logger_pointer   = std::shared_ptr<spdlog::logger>;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::string kernel{"auto"};
+    unsigned batch_size{1024u};
+    unsigned stream_buffer{32u << 20};
+
+    const char* name() const { return "generator"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      bind_and_describe_data(
+          "kernel", kernel,
+          "load kernel |str|, \"auto\", \"scalar\", \"sse\", \"avx2\", "
+          "\"avx512\", \"neon\" or \"stream\"");
+      bind_and_describe_data(
+          "batch_size", batch_size,
+          "work items executed between enable flag checks |uint|, e.g. 1024");
+      bind_and_describe_data("stream_buffer", stream_buffer,
+                             "per-thread buffer of the stream kernel "
+                             "|uint, bytes|, e.g. 33554432");
+    }
+  };
+
+  explicit generator_utilisation_kernels(settings& conf) : conf_{conf} {
+    if (conf_.batch_size == 0)
+      throw std::logic_error("conf->batch_size must be positive");
+
+    name_ = conf_.kernel == "auto" ? exot::apps::utilities::best_kernel()
+                                   : conf_.kernel;
+    kernel_ = exot::apps::utilities::select_kernel(name_);
+
+    if (name_ == "stream" && conf_.stream_buffer < 64u)
+      throw std::logic_error("conf->stream_buffer must hold a cache line");
+
+    debug_log_->info("[generator_utilisation_kernels] using kernel: {}",
+                     name_);
+  }
+
+  bool validate_subtoken(const subtoken_type&) const { return true; }
+
+  decomposed_type decompose_subtoken(const subtoken_type& subtoken,
+                                     core_type, index_type index) const {
+    return index < 64 && ((subtoken >> index) & 1u);
+  }
+
+  void generate_load(const decomposed_type& active,
+                     const enable_flag_type& flag, core_type, index_type) {
+    if (!active) return;
+
+    // the context is allocated once per worker, on its first load
+    thread_local exot::apps::utilities::kernel_context context{
+        name_ == "stream" ? conf_.stream_buffer : 0u};
+
+    auto sink = std::uint64_t{0};
+    while (flag.load(std::memory_order_acquire))
+      sink ^= kernel_(context, conf_.batch_size);
+
+    asm volatile("" : : "r"(sink));
+  }
+
+ private:
+  settings conf_;
+  std::string name_;
+  exot::apps::utilities::load_kernel kernel_;
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::generators
@@ -0,0 +1,254 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/modules/cache_er.h
+ * @author     Bruno Klopott
+ * @brief      A meter module timing the reload of 1-64 last-level cache set
+ *             groups, evicted in between by another process.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/primitives/cache.h>
+#include <exot/utilities/configuration.h>
+#include <exot/utilities/timing.h>
+
+#if defined(__x86_64__)
+#include <exot/primitives/tsc.h>
+#else
+#include <exot/utilities/timing_source.h>
+#endif
+
+#include <exot/apps/utilities/eviction_sets.h>
+#include <exot/apps/utilities/node_memory.h>
+
+namespace exot::apps::modules {
+
+/**
+ * @brief Measures the access time to groups of cache sets with
+ *        Evict+Reload
+ * @details Group j consists of the lines congruent to offset (j * 64)
+ *          modulo set_stride, as used by the cache generators. Every
+ *          measurement reloads the lines of each group and reports the time
+ *          taken, which grows when the lines were evicted since the
+ *          previous measurement. The reload also brings them back into the
+ *          cache for the next period.
+ *
+ *          With "eviction_sets" enabled, the lines of a group are a minimal
+ *          eviction set rather than strided lines, constructed once in the
+ *          constructor, or loaded from the "eviction_cache" directory if an
+ *          earlier run obtained the same hugepages. A minimal set lies in a
+ *          single last-level cache slice, which depends on the physical
+ *          pages of the buffer, so the groups of the meter and of the
+ *          generator only contend if both select their sets the same way.
+ *          Enable it in both or in neither; with strided lines, the default,
+ *          every group spans all slices.
+ */
+class cache_er {
+ public:
+  using return_type    = std::vector<std::uint64_t>;
+  using logger_pointer = std::shared_ptr<spdlog::logger>;
+
+  static constexpr std::size_t line_size = 64;
+  static constexpr std::size_t groups    = 64;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    unsigned set_count{groups};
+    unsigned ways{16u};
+    unsigned set_stride{1u << 17};
+    bool hugepages{true};
+    unsigned hugepage_size{2u << 20};
+    bool eviction_sets{false};
+    unsigned candidates{0u};
+    std::string eviction_cache{};
+    unsigned eviction_threshold{0u};
+
+    const char* name() const { return "cache_er"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      bind_and_describe_data("set_count", set_count,
+                             "number of set groups measured |uint|, 1-64");
+      bind_and_describe_data("ways", ways,
+                             "lines reloaded per cache set |uint|, e.g. the "
+                             "associativity, 16");
+      bind_and_describe_data(
+          "set_stride", set_stride,
+          "distance between lines mapping to the same set |uint, bytes|, "
+          "e.g. 131072 for 2048 sets");
+      bind_and_describe_data("hugepages", hugepages,
+                             "back the buffer with hugepages? |bool|");
+      bind_and_describe_data("hugepage_size", hugepage_size,
+                             "hugepage size |uint, bytes|, e.g. 2097152");
+      bind_and_describe_data(
+          "eviction_sets", eviction_sets,
+          "use minimal eviction sets instead of strided lines? |bool|, "
+          "x86_64 only, must match the generator's setting");
+      bind_and_describe_data(
+          "candidates", candidates,
+          "candidate lines per group for the construction |uint|, 8 times "
+          "the ways if 0");
+      bind_and_describe_data(
+          "eviction_cache", eviction_cache,
+          "directory caching constructed sets |str|, no caching if empty");
+      bind_and_describe_data(
+          "eviction_threshold", eviction_threshold,
+          "load latency above which a load misses |uint, cycles|, "
+          "calibrated if 0");
+    }
+  };
+
+  explicit cache_er(settings& conf) : conf_{conf} {
+    namespace utl = exot::apps::utilities;
+
+    if (conf_.set_count == 0 || conf_.set_count > groups)
+      throw std::logic_error("conf->set_count must be within 1-64");
+    if (conf_.ways == 0)
+      throw std::logic_error("conf->ways must be positive");
+    if (conf_.set_stride < groups * line_size ||
+        conf_.set_stride % line_size != 0)
+      throw std::logic_error(
+          "conf->set_stride must be a multiple of the line size and span "
+          "all set groups");
+
+    if (conf_.eviction_sets && conf_.candidates == 0)
+      conf_.candidates = 8 * conf_.ways;
+    if (conf_.eviction_sets && conf_.candidates <= conf_.ways)
+      throw std::logic_error("conf->candidates must exceed the ways");
+    if (conf_.eviction_sets && !utl::eviction_sets_supported)
+      throw std::logic_error(
+          "conf->eviction_sets is only supported on x86_64");
+
+    auto lines = conf_.eviction_sets ? conf_.candidates : conf_.ways;
+    buffer_    = std::make_unique<utl::node_buffer>(
+        std::size_t{conf_.set_stride} * lines, -1, conf_.hugepages,
+        conf_.hugepage_size);
+
+    if (conf_.eviction_sets) {
+      utl::eviction_set_store store{
+          buffer_->data(), buffer_->size(),
+          buffer_->is_huge() ? conf_.hugepage_size : 4096u,
+          conf_.set_stride, conf_.ways, conf_.eviction_threshold,
+          conf_.eviction_cache};
+      prepare(&store);
+    } else {
+      prepare(nullptr);
+    }
+
+    readings_.resize(conf_.set_count, 0);
+    for (const auto& lines : sets_) reload(buffer_->data(), lines);
+  }
+
+  return_type measure() {
+    auto* base = buffer_->data();
+    for (std::size_t j = 0; j < sets_.size(); ++j) {
+#if defined(__x86_64__)
+      readings_[j] =
+          exot::utilities::timeit<exot::primitives::MemoryFencedTSC>(
+              reload, base, sets_[j]);
+#else
+      readings_[j] =
+          exot::utilities::default_timing_facility(reload, base, sets_[j]);
+#endif
+    }
+    return readings_;
+  }
+
+  std::vector<std::string> header() {
+    std::vector<std::string> names;
+    for (std::size_t j = 0; j < sets_.size(); ++j)
+      names.push_back(fmt::format("{}:set{}", conf_.name(), j));
+    return names;
+  }
+
+ private:
+  static void reload(std::uint8_t* base,
+                     const exot::apps::utilities::eviction_set& lines) {
+    for (auto offset : lines) exot::primitives::access_read<>(base + offset);
+  }
+
+  /**
+   * @brief Gets the lines of every group, from eviction sets if available
+   */
+  void prepare(exot::apps::utilities::eviction_set_store* store) {
+    namespace utl = exot::apps::utilities;
+
+    if (store && !conf_.eviction_cache.empty()) {
+      if (auto* cache = store->cache()) {
+        debug_log_->info("[cache_er] {} cached sets in {}", cache->size(),
+                         cache->path());
+      } else {
+        debug_log_->warn(
+            "[cache_er] physical addresses are unavailable, eviction sets "
+            "will not be cached");
+      }
+    }
+
+    for (auto j = 0u; j < conf_.set_count; ++j) {
+      auto target = j * static_cast<std::uint32_t>(line_size);
+      std::optional<utl::eviction_set> found;
+      if (store) found = store->get(target);
+      if (store && !found)
+        debug_log_->warn(
+            "[cache_er] no eviction set found for group {}, using strided "
+            "lines",
+            j);
+
+      sets_.push_back(found ? std::move(*found)
+                            : utl::strided_set(target, conf_.set_stride,
+                                               conf_.ways));
+    }
+
+    if (store && !store->save())
+      debug_log_->warn("[cache_er] failed to write {}",
+                       store->cache()->path());
+  }
+
+  settings conf_;
+  std::unique_ptr<exot::apps::utilities::node_buffer> buffer_;
+  std::vector<exot::apps::utilities::eviction_set> sets_;
+  return_type readings_;
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::modules
@@ -0,0 +1,150 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/modules/frequency_sysfs.h
+ * @author     Bruno Klopott
+ * @brief      A meter module reading per-core frequencies through persistent
+ *             file descriptors.
+ */
+
+#pragma once
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/sysfs_batch.h>
+
+namespace exot::apps::modules {
+
+/**
+ * @brief Reads the current frequencies of cores in kHz
+ * @details The cpufreq files of all cores are opened once at construction
+ *          and re-read on every measurement, with a pread per core or with
+ *          a single io_uring submission for all cores, such that the cost
+ *          of a sample does not include opening and closing files. A core
+ *          whose read fails, e.g. while it is offline, reads as NaN.
+ */
+class frequency_sysfs {
+ public:
+  using return_type    = std::vector<double>;
+  using logger_pointer = std::shared_ptr<spdlog::logger>;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::vector<unsigned> cores{};
+    std::string source{"scaling_cur_freq"};
+    std::string backend{"pread"};
+
+    const char* name() const { return "frequency_sysfs"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      bind_and_describe_data(
+          "cores", cores,
+          "cores to read |uint[]|, all cores with cpufreq if empty");
+      bind_and_describe_data(
+          "source", source,
+          "cpufreq attribute |str|, \"scaling_cur_freq\" or "
+          "\"cpuinfo_cur_freq\"");
+      bind_and_describe_data("backend", backend,
+                             "read backend |str|, \"pread\" or \"io_uring\"");
+    }
+  };
+
+  explicit frequency_sysfs(settings& conf) : conf_{conf} {
+    static const auto base = std::string{"/sys/devices/system/cpu"};
+
+    if (conf_.source != "scaling_cur_freq" &&
+        conf_.source != "cpuinfo_cur_freq")
+      throw std::logic_error("unknown frequency source: " + conf_.source);
+
+    if (conf_.cores.empty()) {
+      for (auto cpu : exot::apps::utilities::list_numbered_entries(base, "cpu"))
+        if (::access(path(base, cpu).c_str(), R_OK) == 0)
+          conf_.cores.push_back(cpu);
+    }
+    if (conf_.cores.empty())
+      throw std::logic_error("no cores with cpufreq available");
+
+    std::vector<std::string> paths;
+    for (auto core : conf_.cores) paths.push_back(path(base, core));
+
+    auto backend = exot::apps::utilities::parse_sysfs_backend(conf_.backend);
+    files_ = std::make_unique<exot::apps::utilities::sysfs_batch>(paths,
+                                                                  backend);
+    if (files_->backend() != backend)
+      debug_log_->warn(
+          "[frequency_sysfs] io_uring is unavailable, using pread");
+
+    readings_.resize(paths.size());
+  }
+
+  return_type measure() {
+    files_->read(values_);
+    for (std::size_t i = 0; i < values_.size(); ++i)
+      readings_[i] = values_[i] ? static_cast<double>(*values_[i])
+                                : std::numeric_limits<double>::quiet_NaN();
+
+    return readings_;
+  }
+
+  std::vector<std::string> header() {
+    std::vector<std::string> names;
+    for (auto core : conf_.cores)
+      names.push_back(fmt::format("{}:core{}", conf_.name(), core));
+    return names;
+  }
+
+ private:
+  std::string path(const std::string& base, unsigned core) const {
+    return fmt::format("{}/cpu{}/cpufreq/{}", base, core, conf_.source);
+  }
+
+  settings conf_;
+  std::unique_ptr<exot::apps::utilities::sysfs_batch> files_;
+  std::vector<exot::apps::utilities::sysfs_batch::value_type> values_;
+  return_type readings_;
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::modules
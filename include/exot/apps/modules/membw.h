@@ -0,0 +1,290 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/modules/membw.h
+ * @author     Bruno Klopott
+ * @brief      A meter module sampling the achieved memory bandwidth.
+ */
+
+#pragma once
+
+#include <linux/perf_event.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/deadline.h>
+#include <exot/apps/utilities/memory_streams.h>
+#include <exot/apps/utilities/node_memory.h>
+#include <exot/apps/utilities/perf_event.h>
+
+namespace exot::apps::modules {
+
+/**
+ * @brief Samples the memory bandwidth from memory controller counters, or
+ *        with a calibrated probe where those are unavailable
+ * @details In the "imc" mode, the read and write events of all memory
+ *          controller PMUs (by default the CAS counts of Intel's
+ *          uncore_imc_*) are opened on the CPUs given by their cpumasks,
+ *          and the system-wide read and write bandwidth in MiB/s is
+ *          obtained from the scaled count deltas between measurements.
+ *          Opening uncore events usually requires perf_event_paranoid of
+ *          at most 0, or CAP_PERFMON.
+ *
+ *          In the "probe" mode, every measurement reads "probe_size" bytes
+ *          of a buffer larger than the last-level cache, advancing through
+ *          the buffer such that the probed lines come from memory. The
+ *          probe bandwidth is compared to the bandwidth calibrated on an
+ *          idle system at construction, and reported with the contention,
+ *          the fraction of the idle bandwidth lost to other traffic.
+ *
+ *          The "auto" mode uses the counters if they can be opened.
+ */
+class membw {
+ public:
+  using return_type    = std::vector<double>;
+  using logger_pointer = std::shared_ptr<spdlog::logger>;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::string mode{"auto"};
+    std::string pmu{"uncore_imc"};
+    std::string read_event{"cas_count_read"};
+    std::string write_event{"cas_count_write"};
+    unsigned probe_size{1u << 20};
+    unsigned probe_buffer{256u << 20};
+    unsigned calibration_rounds{64u};
+
+    const char* name() const { return "membw"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      bind_and_describe_data(
+          "mode", mode,
+          "bandwidth source |str|, \"imc\", \"probe\" or \"auto\"");
+      bind_and_describe_data("pmu", pmu,
+                             "prefix of the memory controller PMUs |str|, "
+                             "e.g. \"uncore_imc\"");
+      bind_and_describe_data("read_event", read_event,
+                             "PMU event counting reads |str|, e.g. "
+                             "\"cas_count_read\"");
+      bind_and_describe_data("write_event", write_event,
+                             "PMU event counting writes |str|, e.g. "
+                             "\"cas_count_write\"");
+      bind_and_describe_data("probe_size", probe_size,
+                             "bytes read per probe |uint, bytes|, e.g. "
+                             "1048576");
+      bind_and_describe_data(
+          "probe_buffer", probe_buffer,
+          "probed buffer size |uint, bytes|, well above the LLC size");
+      bind_and_describe_data("calibration_rounds", calibration_rounds,
+                             "probes for the idle calibration |uint|");
+    }
+  };
+
+  explicit membw(settings& conf) : conf_{conf} {
+    if (conf_.mode != "auto" && conf_.mode != "imc" && conf_.mode != "probe")
+      throw std::logic_error("unknown membw mode: " + conf_.mode);
+
+    if (conf_.mode != "probe") {
+      open_counters();
+      if (!counters_.empty()) {
+        conf_.mode = "imc";
+      } else if (conf_.mode == "imc") {
+        throw std::runtime_error(fmt::format(
+            "memory controller counters \"{}_*\" cannot be opened",
+            conf_.pmu));
+      } else {
+        debug_log_->info(
+            "[membw] memory controller counters are unavailable, using "
+            "the probe");
+        conf_.mode = "probe";
+      }
+    }
+
+    if (conf_.mode == "probe") calibrate();
+
+    last_ = exot::apps::utilities::monotonic_ns();
+    readings_.resize(2, 0.0);
+  }
+
+  return_type measure() {
+    if (counters_.empty()) {
+      auto bandwidth = probe();
+      readings_[0]   = bandwidth;
+      readings_[1]   = std::max(0.0, 1.0 - bandwidth / baseline_);
+      return readings_;
+    }
+
+    auto now     = exot::apps::utilities::monotonic_ns();
+    auto elapsed = static_cast<double>(now - last_) * 1e-9;
+    last_        = now;
+
+    std::fill(readings_.begin(), readings_.end(), 0.0);
+    for (auto& counter : counters_) {
+      auto value = counter.fd.read();
+      if (!value) continue;
+      auto delta = *value - counter.last;
+      counter.last = *value;
+      if (elapsed > 0.0)
+        readings_[counter.direction] +=
+            static_cast<double>(delta) * counter.scale / elapsed;
+    }
+
+    return readings_;
+  }
+
+  std::vector<std::string> header() {
+    if (counters_.empty())
+      return {fmt::format("{}:probe_MiBps", conf_.name()),
+              fmt::format("{}:contention", conf_.name())};
+    return {fmt::format("{}:read_MiBps", conf_.name()),
+            fmt::format("{}:write_MiBps", conf_.name())};
+  }
+
+ private:
+  struct counter {
+    exot::apps::utilities::perf_counter fd;
+    std::size_t direction;  //! 0 for reads, 1 for writes
+    double scale;           //! MiB per count
+    std::uint64_t last;
+  };
+
+  void open_counters() {
+    namespace utl = exot::apps::utilities;
+
+    const std::string* events[] = {&conf_.read_event, &conf_.write_event};
+
+    for (const auto& pmu : utl::list_pmus(conf_.pmu)) {
+      for (std::size_t direction = 0; direction < 2; ++direction) {
+        auto event = utl::resolve_pmu_event(pmu, *events[direction]);
+        if (!event) continue;
+
+        /* Scales in sysfs are given in MiB for the IMC CAS counts, other
+         * PMUs without a scale are assumed to count 64-byte lines. */
+        auto scale = event->scale != 1.0 ? event->scale : 64.0 / (1 << 20);
+        if (event->cpus.empty()) event->cpus.push_back(0);
+
+        for (auto cpu : event->cpus) {
+          ::perf_event_attr attr;
+          std::memset(&attr, 0, sizeof(attr));
+          attr.size   = sizeof(attr);
+          attr.type   = event->type;
+          attr.config = event->config;
+
+          utl::perf_counter fd{utl::perf_event_open(attr, -1, cpu, -1)};
+          if (!fd.is_open()) {
+            debug_log_->debug("[membw] cannot open {}/{} on cpu {}: {}", pmu,
+                              *events[direction], cpu, std::strerror(errno));
+            continue;
+          }
+
+          auto initial = fd.read().value_or(0);
+          counters_.push_back({std::move(fd), direction, scale, initial});
+        }
+      }
+    }
+
+    debug_log_->info("[membw] opened {} memory controller counters",
+                     counters_.size());
+  }
+
+  /**
+   * @brief Reads the next window of the probe buffer
+   * @return The achieved bandwidth in MiB/s
+   */
+  double probe() {
+    namespace utl = exot::apps::utilities;
+
+    auto start = utl::monotonic_ns();
+    sink_ ^= utl::stream_read(buffer_->data() + position_, conf_.probe_size);
+    auto elapsed = utl::monotonic_ns() - start;
+
+    position_ = (position_ + conf_.probe_size) % conf_.probe_buffer;
+    return static_cast<double>(conf_.probe_size) / (1u << 20) /
+           (static_cast<double>(std::max<std::int64_t>(elapsed, 1)) * 1e-9);
+  }
+
+  /**
+   * @brief Allocates the probe buffer and calibrates the idle bandwidth
+   * @details Uses the median of the probes of a full pass, which are all
+   *          served from memory, followed by the calibration rounds.
+   */
+  void calibrate() {
+    if (conf_.probe_size == 0 || conf_.probe_size % 64 != 0)
+      throw std::logic_error(
+          "conf->probe_size must be a positive multiple of 64 bytes");
+    if (conf_.probe_buffer < 2 * conf_.probe_size)
+      throw std::logic_error(
+          "conf->probe_buffer must hold at least two probes");
+    conf_.probe_buffer -= conf_.probe_buffer % conf_.probe_size;
+
+    buffer_ = std::make_unique<exot::apps::utilities::node_buffer>(
+        conf_.probe_buffer, -1, false);
+
+    for (std::size_t i = 0; i < conf_.probe_buffer / conf_.probe_size; ++i)
+      probe();
+
+    std::vector<double> rounds;
+    for (auto i = 0u; i < std::max(conf_.calibration_rounds, 1u); ++i)
+      rounds.push_back(probe());
+    std::nth_element(rounds.begin(), rounds.begin() + rounds.size() / 2,
+                     rounds.end());
+    baseline_ = rounds[rounds.size() / 2];
+
+    debug_log_->info("[membw] idle probe bandwidth: {:.1f} MiB/s",
+                     baseline_);
+  }
+
+  settings conf_;
+  std::vector<counter> counters_;
+  std::unique_ptr<exot::apps::utilities::node_buffer> buffer_;
+  std::size_t position_{0};
+  double baseline_{1.0};
+  std::uint64_t sink_{0};
+  std::int64_t last_{0};
+  return_type readings_;
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::modules
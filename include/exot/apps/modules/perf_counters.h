@@ -0,0 +1,319 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/modules/perf_counters.h
+ * @author     Bruno Klopott
+ * @brief      A meter module sampling hardware performance counters of cores
+ *             through perf_event groups.
+ */
+
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/perf_event.h>
+#include <exot/apps/utilities/topology.h>
+
+namespace exot::apps::modules {
+
+/**
+ * @brief Counts hardware events per core between measurements
+ * @details The events of every core form a group, which the kernel
+ *          schedules onto the PMU together, and the whole group is read
+ *          with a single read(). When more events are requested than the
+ *          PMU has counters, groups are multiplexed and the counts are
+ *          scaled by the ratio of the enabled to the running time.
+ *
+ *          With "rdpmc" enabled and the meter thread pinned to a single
+ *          core, the group of that core is read with the rdpmc instruction
+ *          instead, without a system call, provided the kernel allows
+ *          user-space counter access. The affinity is checked once, on the
+ *          first measurement, since a thread allowed to migrate could read
+ *          the counters of one core while running on another. Unpinned
+ *          meters read all groups with read().
+ *
+ *          Counting all tasks on a core requires perf_event_paranoid of at
+ *          most 0, or CAP_PERFMON.
+ */
+class perf_counters {
+ public:
+  using return_type    = std::vector<std::uint64_t>;
+  using logger_pointer = std::shared_ptr<spdlog::logger>;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::vector<std::string> events{"cycles", "instructions",
+                                    "llc-load-misses", "branch-misses"};
+    std::vector<unsigned> cores{};
+    bool exclude_kernel{false};
+    bool rdpmc{true};
+
+    const char* name() const { return "perf_counters"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      bind_and_describe_data(
+          "events", events,
+          "events counted on every core |str[]|, e.g. [\"cycles\", "
+          "\"instructions\", \"llc-load-misses\", \"raw:0x1c0\", "
+          "\"cpu/mem-loads\"]");
+      bind_and_describe_data("cores", cores,
+                             "cores to count on |uint[]|, all if empty");
+      bind_and_describe_data("exclude_kernel", exclude_kernel,
+                             "count only user-space events? |bool|");
+      bind_and_describe_data(
+          "rdpmc", rdpmc,
+          "read the meter's own core with rdpmc where allowed? |bool|, "
+          "requires the host to be pinned to a single core, see "
+          "\"should_pin_host\"");
+    }
+  };
+
+  explicit perf_counters(settings& conf) : conf_{conf} {
+    namespace utl = exot::apps::utilities;
+
+    if (conf_.events.empty())
+      throw std::logic_error("conf->events must not be empty");
+
+    std::vector<utl::perf_event_spec> specs;
+    for (const auto& name : conf_.events) {
+      auto spec = utl::parse_perf_event(name);
+      if (!spec) throw std::logic_error("unknown perf event: " + name);
+      specs.push_back(*spec);
+    }
+
+    if (conf_.cores.empty())
+      for (const auto& entry : utl::cpu_topologies())
+        conf_.cores.push_back(entry.cpu);
+
+    for (auto core : conf_.cores) open_group(core, specs);
+
+    for (auto& group : groups_) {
+      ::ioctl(group.fds.front().fd(), PERF_EVENT_IOC_RESET,
+              PERF_IOC_FLAG_GROUP);
+      ::ioctl(group.fds.front().fd(), PERF_EVENT_IOC_ENABLE,
+              PERF_IOC_FLAG_GROUP);
+      read_group(group, -1);
+      group.last = group.values;
+      group.last_enabled = group.enabled;
+      group.last_running = group.running;
+    }
+
+    debug_log_->info("[perf_counters] {} events on {} cores",
+                     specs.size(), groups_.size());
+    readings_.resize(groups_.size() * specs.size(), 0);
+  }
+
+  ~perf_counters() {
+    auto reads = std::uint64_t{0};
+    for (const auto& group : groups_) reads += group.rdpmc_reads;
+    debug_log_->info("[perf_counters] {} group reads with rdpmc", reads);
+  }
+
+  return_type measure() {
+    if (!affinity_checked_) {
+      rdpmc_cpu_        = conf_.rdpmc ? pinned_cpu() : -1;
+      affinity_checked_ = true;
+      if (conf_.rdpmc && rdpmc_cpu_ < 0)
+        debug_log_->warn(
+            "[perf_counters] meter thread not pinned to a single core, "
+            "rdpmc disabled");
+    }
+
+    auto events = conf_.events.size();
+
+    for (std::size_t g = 0; g < groups_.size(); ++g) {
+      auto& group = groups_[g];
+      if (!read_group(group, rdpmc_cpu_)) continue;
+
+      /* Times taken from the user page are only updated when the group
+       * is scheduled, and may lag those returned by read(). */
+      auto enabled = delta_of(group.enabled, group.last_enabled);
+      auto running = delta_of(group.running, group.last_running);
+      auto ratio   = running != 0 && enabled > running
+                       ? static_cast<double>(enabled) /
+                             static_cast<double>(running)
+                       : 1.0;
+
+      for (std::size_t e = 0; e < events; ++e) {
+        auto delta = group.values[e] - group.last[e];
+        readings_[g * events + e] = static_cast<std::uint64_t>(
+            std::llround(static_cast<double>(delta) * ratio));
+      }
+
+      group.last         = group.values;
+      group.last_enabled = group.enabled;
+      group.last_running = group.running;
+    }
+
+    return readings_;
+  }
+
+  std::vector<std::string> header() {
+    std::vector<std::string> names;
+    for (const auto& group : groups_)
+      for (const auto& event : conf_.events)
+        names.push_back(
+            fmt::format("{}:core{}:{}", conf_.name(), group.core, event));
+    return names;
+  }
+
+ private:
+  struct group {
+    unsigned core;
+    std::vector<exot::apps::utilities::perf_counter> fds;  //! leader first
+    std::vector<exot::apps::utilities::perf_user_page> pages;
+    std::vector<std::uint64_t> buffer;  //! nr, enabled, running, values
+    std::vector<std::uint64_t> values;
+    std::vector<std::uint64_t> last;
+    std::uint64_t enabled{0}, running{0};
+    std::uint64_t last_enabled{0}, last_running{0};
+    std::uint64_t rdpmc_reads{0};
+  };
+
+  void open_group(unsigned core,
+                  const std::vector<exot::apps::utilities::perf_event_spec>&
+                      specs) {
+    namespace utl = exot::apps::utilities;
+
+    group entry;
+    entry.core = core;
+
+    for (const auto& spec : specs) {
+      ::perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size           = sizeof(attr);
+      attr.type           = spec.type;
+      attr.config         = spec.config;
+      attr.exclude_kernel = conf_.exclude_kernel;
+      attr.exclude_hv     = 1;
+      attr.read_format    = PERF_FORMAT_GROUP |
+                         PERF_FORMAT_TOTAL_TIME_ENABLED |
+                         PERF_FORMAT_TOTAL_TIME_RUNNING;
+      attr.disabled = entry.fds.empty();
+
+      auto leader = entry.fds.empty() ? -1 : entry.fds.front().fd();
+      utl::perf_counter fd{utl::perf_event_open(
+          attr, -1, static_cast<int>(core), leader, PERF_FLAG_FD_CLOEXEC)};
+      if (!fd.is_open())
+        throw std::runtime_error(fmt::format(
+            "failed to open {:#x}:{:#x} on core {}: {}; counting all tasks "
+            "requires perf_event_paranoid <= 0 or CAP_PERFMON",
+            spec.type, spec.config, core, std::strerror(errno)));
+
+      if (conf_.rdpmc) entry.pages.emplace_back(fd.fd());
+      entry.fds.push_back(std::move(fd));
+    }
+
+    entry.buffer.resize(3 + specs.size());
+    entry.values.resize(specs.size());
+    groups_.push_back(std::move(entry));
+  }
+
+  /**
+   * @brief Gets the only CPU the calling thread may run on, or -1
+   */
+  static int pinned_cpu() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) != 0) return -1;
+    if (CPU_COUNT(&set) != 1) return -1;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      if (CPU_ISSET(cpu, &set)) return cpu;
+    return -1;
+  }
+
+  static std::uint64_t delta_of(std::uint64_t value, std::uint64_t last) {
+    return value > last ? value - last : 0;
+  }
+
+  /**
+   * @brief Reads a group with rdpmc if it belongs to the given CPU, or
+   *        with a single read()
+   */
+  bool read_group(group& entry, int cpu) {
+    if (static_cast<int>(entry.core) == cpu && !entry.pages.empty() &&
+        read_user(entry)) {
+      ++entry.rdpmc_reads;
+      return true;
+    }
+
+    auto size   = entry.buffer.size() * sizeof(std::uint64_t);
+    auto length = ::read(entry.fds.front().fd(), entry.buffer.data(), size);
+    if (length != static_cast<ssize_t>(size)) return false;
+
+    entry.enabled = entry.buffer[1];
+    entry.running = entry.buffer[2];
+    std::copy(entry.buffer.begin() + 3, entry.buffer.end(),
+              entry.values.begin());
+    return true;
+  }
+
+  bool read_user(group& entry) {
+    std::uint64_t enabled, running;
+    for (std::size_t e = 0; e < entry.pages.size(); ++e) {
+      if (!entry.pages[e].read(entry.values[e], enabled, running))
+        return false;
+      if (e == 0) {
+        entry.enabled = enabled;
+        entry.running = running;
+      }
+    }
+    return true;
+  }
+
+  settings conf_;
+  std::vector<group> groups_;
+  return_type readings_;
+  int rdpmc_cpu_{-1};  //! the pinned meter core, or -1 if not pinned
+  bool affinity_checked_{false};
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::modules
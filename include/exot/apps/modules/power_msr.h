@@ -0,0 +1,208 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/modules/power_msr.h
+ * @author     Bruno Klopott
+ * @brief      A meter module computing power from the RAPL energy counters,
+ *             with batched register access.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/deadline.h>
+#include <exot/apps/utilities/msr_batch.h>
+#include <exot/apps/utilities/topology.h>
+
+namespace exot::apps::modules {
+
+/**
+ * @brief Computes the average power in W of RAPL domains between
+ *        measurements
+ * @details RAPL counters are per package, so one CPU of each package is
+ *          read, and the number of registers per sample depends only on the
+ *          number of packages and domains. Domains which cannot be read on
+ *          the platform, e.g. "pp1" on servers, are omitted. The 32-bit
+ *          energy counters wrap around after tens of seconds at high power,
+ *          so the measurement period must be shorter than that.
+ *
+ *          A channel whose register cannot be read reports NaN. Every
+ *          channel keeps the time of its last good read, so the next good
+ *          read averages the energy over the whole interval since then.
+ */
+class power_msr {
+ public:
+  using return_type    = std::vector<double>;
+  using logger_pointer = std::shared_ptr<spdlog::logger>;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::vector<std::string> domains{"pkg", "pp0", "pp1", "dram"};
+    double dram_energy_unit{0.0};
+    std::string backend{"auto"};
+
+    const char* name() const { return "power_msr"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      bind_and_describe_data(
+          "domains", domains,
+          "RAPL domains to read |str[]|, \"pkg\", \"pp0\", \"pp1\" or "
+          "\"dram\"");
+      bind_and_describe_data(
+          "dram_energy_unit", dram_energy_unit,
+          "energy unit of the DRAM domain |J|, e.g. 15.3e-6 on some "
+          "servers, the package unit if 0");
+      bind_and_describe_data(
+          "backend", backend,
+          "register access |str|, \"msr\", \"msr_batch\" or \"auto\"");
+    }
+  };
+
+  explicit power_msr(settings& conf) : conf_{conf} {
+    namespace utl = exot::apps::utilities;
+
+    batch_ = std::make_unique<utl::msr_batch>(
+        utl::parse_msr_backend(conf_.backend));
+
+    for (const auto& domain : conf_.domains) register_of(domain);
+
+    auto packages = utl::one_per_package(utl::cpu_topologies());
+    if (packages.empty()) throw std::logic_error("no CPUs found in sysfs");
+
+    for (const auto& entry : packages) {
+      auto units = utl::read_msr(entry.cpu, power_unit);
+      if (!units)
+        throw std::runtime_error(fmt::format(
+            "failed to read the RAPL units on cpu {}", entry.cpu));
+      auto energy_unit =
+          1.0 / static_cast<double>(std::uint64_t{1} << ((*units >> 8) & 0x1f));
+
+      for (const auto& domain : conf_.domains) {
+        auto reg = register_of(domain);
+        if (!utl::read_msr(entry.cpu, reg)) {
+          debug_log_->info("[power_msr] domain {} is unavailable on cpu {}",
+                           domain, entry.cpu);
+          continue;
+        }
+
+        auto unit = domain == "dram" && conf_.dram_energy_unit > 0.0
+                        ? conf_.dram_energy_unit
+                        : energy_unit;
+        channels_.push_back({batch_->add(entry.cpu, reg), unit, 0, 0,
+                             fmt::format("{}{}", domain, entry.package)});
+      }
+    }
+
+    if (channels_.empty())
+      throw std::logic_error("no RAPL domains could be read");
+
+    debug_log_->info("[power_msr] {} registers, backend: {}", batch_->size(),
+                     utl::to_string(batch_->backend()));
+
+    batch_->read();
+    auto now = utl::monotonic_ns();
+    for (auto& channel : channels_) {
+      channel.last      = batch_->value(channel.slot);
+      channel.last_time = now;
+    }
+    readings_.resize(channels_.size(), 0.0);
+  }
+
+  return_type measure() {
+    batch_->read();
+    auto now = exot::apps::utilities::monotonic_ns();
+
+    for (std::size_t i = 0; i < channels_.size(); ++i) {
+      auto& channel = channels_[i];
+      if (!batch_->ok(channel.slot)) {
+        readings_[i] = std::numeric_limits<double>::quiet_NaN();
+        continue;
+      }
+
+      auto value        = batch_->value(channel.slot);
+      auto delta        = (value - channel.last) & 0xffffffffu;
+      auto elapsed      = static_cast<double>(now - channel.last_time) * 1e-9;
+      channel.last      = value;
+      channel.last_time = now;
+      if (elapsed > 0.0)
+        readings_[i] = static_cast<double>(delta) * channel.unit / elapsed;
+    }
+
+    return readings_;
+  }
+
+  std::vector<std::string> header() {
+    std::vector<std::string> names;
+    for (const auto& channel : channels_)
+      names.push_back(fmt::format("{}:{}", conf_.name(), channel.name));
+    return names;
+  }
+
+ private:
+  static constexpr std::uint32_t power_unit = 0x606;
+
+  struct channel {
+    std::size_t slot;
+    double unit;         //! J per count
+    std::uint64_t last;      //! previous counter value
+    std::int64_t last_time;  //! time of the previous good read, in ns
+    std::string name;
+  };
+
+  static std::uint32_t register_of(const std::string& domain) {
+    if (domain == "pkg") return 0x611;
+    if (domain == "pp0") return 0x639;
+    if (domain == "pp1") return 0x641;
+    if (domain == "dram") return 0x619;
+    throw std::logic_error("unknown RAPL domain: " + domain);
+  }
+
+  settings conf_;
+  std::unique_ptr<exot::apps::utilities::msr_batch> batch_;
+  std::vector<channel> channels_;
+  return_type readings_;
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::modules
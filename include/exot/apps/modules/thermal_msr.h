@@ -0,0 +1,197 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/modules/thermal_msr.h
+ * @author     Bruno Klopott
+ * @brief      A meter module reading core and package temperatures from the
+ *             digital thermal sensors, with batched register access.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/msr_batch.h>
+#include <exot/apps/utilities/topology.h>
+
+namespace exot::apps::modules {
+
+/**
+ * @brief Reads temperatures in degrees Celsius from IA32_THERM_STATUS and
+ *        IA32_PACKAGE_THERM_STATUS
+ * @details The sensors are per physical core and per package. By default
+ *          every online CPU is read, as in exot::modules::thermal_msr, such
+ *          that hardware threads of a core report the same sensor; with
+ *          "one_per_core" set, only one thread of each core is read. One
+ *          CPU of each package reads the package sensor. Temperatures are
+ *          the distance to TjMax, which is read once per package from
+ *          MSR_TEMPERATURE_TARGET. Failed reads and readings without the
+ *          valid bit are NaN.
+ */
+class thermal_msr {
+ public:
+  using return_type    = std::vector<double>;
+  using logger_pointer = std::shared_ptr<spdlog::logger>;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::vector<unsigned> cores{};
+    bool one_per_core{false};
+    bool package{true};
+    std::string backend{"auto"};
+
+    const char* name() const { return "thermal_msr"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      bind_and_describe_data(
+          "cores", cores,
+          "CPUs to read |uint[]|, all online CPUs if empty");
+      bind_and_describe_data(
+          "one_per_core", one_per_core,
+          "read one thread per physical core if cores is empty? |bool|");
+      bind_and_describe_data("package", package,
+                             "read the package temperatures? |bool|");
+      bind_and_describe_data(
+          "backend", backend,
+          "register access |str|, \"msr\", \"msr_batch\" or \"auto\"");
+    }
+  };
+
+  explicit thermal_msr(settings& conf) : conf_{conf} {
+    namespace utl = exot::apps::utilities;
+
+    batch_ = std::make_unique<utl::msr_batch>(
+        utl::parse_msr_backend(conf_.backend));
+
+    auto topology = utl::cpu_topologies();
+    if (topology.empty()) throw std::logic_error("no CPUs found in sysfs");
+
+    if (conf_.cores.empty()) {
+      auto cpus = conf_.one_per_core ? utl::one_per_core(topology) : topology;
+      for (const auto& entry : cpus) conf_.cores.push_back(entry.cpu);
+    }
+
+    for (auto cpu : conf_.cores) {
+      auto it = std::find_if(topology.begin(), topology.end(),
+                             [cpu](const auto& e) { return e.cpu == cpu; });
+      if (it == topology.end())
+        throw std::logic_error(fmt::format("cpu {} is not online", cpu));
+      add_sensor(cpu, it->package, core_status);
+    }
+
+    if (conf_.package) {
+      for (const auto& entry : utl::one_per_package(topology)) {
+        packages_.push_back(entry.package);
+        add_sensor(entry.cpu, entry.package, package_status);
+      }
+    }
+
+    debug_log_->info("[thermal_msr] {} registers, backend: {}",
+                     batch_->size(), utl::to_string(batch_->backend()));
+
+    readings_.resize(sensors_.size());
+  }
+
+  return_type measure() {
+    batch_->read();
+    for (std::size_t i = 0; i < sensors_.size(); ++i) {
+      const auto& sensor = sensors_[i];
+      auto status  = batch_->value(sensor.slot);
+      auto valid   = batch_->ok(sensor.slot) && ((status >> 31) & 1) != 0;
+      auto readout = static_cast<double>((status >> 16) & 0x7f);
+      readings_[i] = valid ? sensor.tjmax - readout
+                           : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    return readings_;
+  }
+
+  std::vector<std::string> header() {
+    std::vector<std::string> names;
+    for (auto cpu : conf_.cores)
+      names.push_back(fmt::format("{}:core{}", conf_.name(), cpu));
+    for (auto package : packages_)
+      names.push_back(fmt::format("{}:package{}", conf_.name(), package));
+    return names;
+  }
+
+ private:
+  static constexpr std::uint32_t core_status        = 0x19c;
+  static constexpr std::uint32_t package_status     = 0x1b1;
+  static constexpr std::uint32_t temperature_target = 0x1a2;
+
+  struct sensor {
+    std::size_t slot;
+    double tjmax;
+  };
+
+  void add_sensor(unsigned cpu, unsigned package, std::uint32_t reg) {
+    sensors_.push_back({batch_->add(cpu, reg), tjmax(cpu, package)});
+  }
+
+  /**
+   * @brief Gets TjMax of a package, reading it on first use
+   */
+  double tjmax(unsigned cpu, unsigned package) {
+    if (package >= tjmax_.size()) tjmax_.resize(package + 1, 0.0);
+    if (tjmax_[package] == 0.0) {
+      auto target = exot::apps::utilities::read_msr(cpu, temperature_target);
+      if (!target)
+        throw std::runtime_error(
+            fmt::format("failed to read TjMax on cpu {}", cpu));
+      tjmax_[package] = static_cast<double>((*target >> 16) & 0xff);
+    }
+    return tjmax_[package];
+  }
+
+  settings conf_;
+  std::unique_ptr<exot::apps::utilities::msr_batch> batch_;
+  std::vector<sensor> sensors_;
+  std::vector<unsigned> packages_;
+  std::vector<double> tjmax_;
+  return_type readings_;
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::modules
@@ -0,0 +1,132 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/modules/thermal_sysfs.h
+ * @author     Bruno Klopott
+ * @brief      A meter module reading thermal zones through persistent file
+ *             descriptors.
+ */
+
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/sysfs_batch.h>
+
+namespace exot::apps::modules {
+
+/**
+ * @brief Reads temperatures of thermal zones in degrees Celsius
+ * @details The temperature files are opened once at construction and
+ *          re-read on every measurement, with a pread per zone or with a
+ *          single io_uring submission for all zones. A zone whose read
+ *          fails reads as NaN, such that it cannot pass for a temperature.
+ */
+class thermal_sysfs {
+ public:
+  using return_type    = std::vector<double>;
+  using logger_pointer = std::shared_ptr<spdlog::logger>;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::vector<unsigned> zones{};
+    std::string backend{"pread"};
+
+    const char* name() const { return "thermal_sysfs"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      bind_and_describe_data(
+          "zones", zones,
+          "thermal zones to read |uint[]|, all available zones if empty");
+      bind_and_describe_data("backend", backend,
+                             "read backend |str|, \"pread\" or \"io_uring\"");
+    }
+  };
+
+  explicit thermal_sysfs(settings& conf) : conf_{conf} {
+    static const auto base = std::string{"/sys/class/thermal"};
+
+    if (conf_.zones.empty())
+      conf_.zones =
+          exot::apps::utilities::list_numbered_entries(base, "thermal_zone");
+    if (conf_.zones.empty())
+      throw std::logic_error("no thermal zones available");
+
+    std::vector<std::string> paths;
+    for (auto zone : conf_.zones)
+      paths.push_back(fmt::format("{}/thermal_zone{}/temp", base, zone));
+
+    auto backend = exot::apps::utilities::parse_sysfs_backend(conf_.backend);
+    files_ = std::make_unique<exot::apps::utilities::sysfs_batch>(paths,
+                                                                  backend);
+    if (files_->backend() != backend)
+      debug_log_->warn("[thermal_sysfs] io_uring is unavailable, using pread");
+
+    readings_.resize(paths.size());
+  }
+
+  return_type measure() {
+    files_->read(values_);
+    for (std::size_t i = 0; i < values_.size(); ++i)
+      readings_[i] = values_[i]
+                         ? static_cast<double>(*values_[i]) / 1000.0
+                         : std::numeric_limits<double>::quiet_NaN();
+
+    return readings_;
+  }
+
+  std::vector<std::string> header() {
+    std::vector<std::string> names;
+    for (auto zone : conf_.zones)
+      names.push_back(fmt::format("{}:zone{}", conf_.name(), zone));
+    return names;
+  }
+
+ private:
+  settings conf_;
+  std::unique_ptr<exot::apps::utilities::sysfs_batch> files_;
+  std::vector<exot::apps::utilities::sysfs_batch::value_type> values_;
+  return_type readings_;
+
+  logger_pointer debug_log_ =
+      spdlog::get("log") ? spdlog::get("log") : spdlog::stderr_color_mt("log");
+};
+
+}  // namespace exot::apps::modules
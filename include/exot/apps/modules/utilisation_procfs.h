@@ -0,0 +1,119 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/modules/utilisation_procfs.h
+ * @author     Bruno Klopott
+ * @brief      A meter module computing per-core utilisation from /proc/stat.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <exot/utilities/configuration.h>
+
+#include <exot/apps/utilities/proc_stat.h>
+
+namespace exot::apps::modules {
+
+/**
+ * @brief Computes the utilisation of cores between measurements
+ * @details The utilisation is the fraction of the elapsed ticks which a
+ *          core spent busy, in [0, 1]. /proc/stat advances in scheduler
+ *          ticks, so periods shorter than a tick (e.g. 4 ms at 250 Hz)
+ *          observe no change on some samples; those repeat the previous
+ *          utilisation of the core.
+ */
+class utilisation_procfs {
+ public:
+  using return_type = std::vector<double>;
+
+  struct settings : public exot::utilities::configurable<settings> {
+    std::vector<unsigned> cores{};
+
+    const char* name() const { return "utilisation_procfs"; }
+
+    /* @brief The JSON configuration function */
+    void configure() {
+      bind_and_describe_data("cores", cores,
+                             "cores to report |uint[]|, all cores if empty");
+    }
+  };
+
+  explicit utilisation_procfs(settings& conf) : conf_{conf} {
+    const auto& available = stat_.cores();
+    if (conf_.cores.empty()) conf_.cores = available;
+
+    for (auto core : conf_.cores) {
+      auto it = std::find(available.begin(), available.end(), core);
+      if (it == available.end())
+        throw std::logic_error(
+            fmt::format("core {} is not present in /proc/stat", core));
+      slots_.push_back(static_cast<std::size_t>(it - available.begin()));
+    }
+
+    readings_.resize(slots_.size(), 0.0);
+  }
+
+  return_type measure() {
+    if (!stat_.read()) return readings_;
+
+    const auto& busy  = stat_.busy_delta();
+    const auto& total = stat_.total_delta();
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+      auto slot = slots_[i];
+      if (total[slot] != 0)
+        readings_[i] = static_cast<double>(busy[slot]) /
+                       static_cast<double>(total[slot]);
+    }
+
+    return readings_;
+  }
+
+  std::vector<std::string> header() {
+    std::vector<std::string> names;
+    for (auto core : conf_.cores)
+      names.push_back(fmt::format("{}:core{}", conf_.name(), core));
+    return names;
+  }
+
+ private:
+  settings conf_;
+  exot::apps::utilities::proc_stat stat_;
+  std::vector<std::size_t> slots_;
+  return_type readings_;
+};
+
+}  // namespace exot::apps::modules
@@ -0,0 +1,232 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/binary_format.h
+ * @author     Bruno Klopott
+ * @brief      Self-describing binary format for meter outputs.
+ *
+ * A binary meter output consists of a file header, followed by channel
+ * descriptions, followed by a sequence of records:
+ *
+ *   | magic "EXOTMETR" | version u16 | encoding u16 | channel count u32 |
+ *   | record size u32  | flags u32 |
+ *   | type u8 | name length u16 | name ... |  (once per channel)
+ *   | timestamp i64 | channel values ... |   (once per record)
+ *
+ * All values are stored in the host's native byte order; the version field
+ * is used to detect a mismatch. In the raw encoding each record has a fixed
+ * width, the values are packed without padding. In the delta encoding each
+ * record is coded relative to the previous one (see delta_encoding.h); the
+ * record size still describes the decoded record.
+ *
+ * If the lz4 flag is set, the data following the channel descriptions is
+ * split into blocks, each preceded by its decoded and encoded size (u32).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <exot/apps/utilities/channels.h>
+
+namespace exot::apps::utilities {
+
+inline constexpr char binary_magic[8] = {'E', 'X', 'O', 'T', 'M', 'E', 'T', 'R'};
+inline constexpr std::uint16_t binary_version = 1;
+
+/**
+ * @brief The encoding of records following the header
+ */
+enum class record_encoding : std::uint16_t {
+  raw   = 0,  //! fixed-width records
+  delta = 1,  //! per-column delta and zig-zag varint coded records
+};
+
+/**
+ * @brief Flags describing the framing of the data following the header
+ */
+enum binary_flags : std::uint32_t {
+  lz4_blocks = 1u << 0,  //! data is split into LZ4-compressed blocks
+};
+
+/**
+ * @brief The fixed part of the binary file header
+ */
+struct binary_header {
+  char magic[8];
+  std::uint16_t version;
+  std::uint16_t encoding;
+  std::uint32_t channel_count;
+  std::uint32_t record_size;
+  std::uint32_t flags;
+};
+
+static_assert(sizeof(binary_header) == 24, "binary header must be packed");
+
+/**
+ * @brief Describes the layout of records in a binary output
+ */
+struct binary_layout {
+  record_encoding encoding{record_encoding::raw};
+  std::uint32_t flags{0};
+  std::vector<channel_description> channels;
+
+  /**
+   * @brief Size of a single raw record in bytes, including the timestamp
+   */
+  std::size_t record_size() const {
+    auto size = sizeof(std::int64_t);
+    for (const auto& channel : channels) size += channel_size(channel.type);
+    return size;
+  }
+};
+
+/**
+ * @brief Serialises the header and channel descriptions
+ */
+inline std::vector<char> serialise_header(const binary_layout& layout) {
+  auto header = binary_header{};
+  std::memcpy(header.magic, binary_magic, sizeof(binary_magic));
+  header.version       = binary_version;
+  header.encoding      = static_cast<std::uint16_t>(layout.encoding);
+  header.channel_count = static_cast<std::uint32_t>(layout.channels.size());
+  header.record_size   = static_cast<std::uint32_t>(layout.record_size());
+  header.flags         = layout.flags;
+
+  auto out = std::vector<char>(sizeof(header));
+  std::memcpy(out.data(), &header, sizeof(header));
+
+  for (const auto& channel : layout.channels) {
+    auto type   = static_cast<std::uint8_t>(channel.type);
+    auto length = static_cast<std::uint16_t>(channel.name.size());
+    out.push_back(static_cast<char>(type));
+    out.insert(out.end(), reinterpret_cast<const char*>(&length),
+               reinterpret_cast<const char*>(&length) + sizeof(length));
+    out.insert(out.end(), channel.name.begin(), channel.name.end());
+  }
+
+  return out;
+}
+
+/**
+ * @brief Reads the header and channel descriptions from a file
+ *
+ * @param  file  The file, positioned at the beginning
+ * @return The layout of records following the header
+ */
+inline binary_layout read_header(std::FILE* file) {
+  auto header = binary_header{};
+
+  if (std::fread(&header, sizeof(header), 1, file) != 1)
+    throw std::runtime_error("file too short to contain a binary header");
+  if (std::memcmp(header.magic, binary_magic, sizeof(binary_magic)) != 0)
+    throw std::runtime_error("not a binary meter output");
+  if (header.version != binary_version)
+    throw std::runtime_error("unsupported binary format version " +
+                             std::to_string(header.version));
+
+  auto layout     = binary_layout{};
+  layout.encoding = static_cast<record_encoding>(header.encoding);
+  layout.flags    = header.flags;
+  layout.channels.reserve(header.channel_count);
+
+  for (auto i = 0u; i < header.channel_count; ++i) {
+    auto type   = std::uint8_t{};
+    auto length = std::uint16_t{};
+
+    if (std::fread(&type, sizeof(type), 1, file) != 1 ||
+        std::fread(&length, sizeof(length), 1, file) != 1)
+      throw std::runtime_error("truncated channel description");
+    if (!is_valid_channel_type(type))
+      throw std::runtime_error("invalid channel type " + std::to_string(type));
+
+    auto name = std::string(length, '\0');
+    if (length != 0 && std::fread(name.data(), length, 1, file) != 1)
+      throw std::runtime_error("truncated channel name");
+
+    layout.channels.push_back({std::move(name), channel_type{type}});
+  }
+
+  if (layout.record_size() != header.record_size)
+    throw std::runtime_error("record size does not match channel layout");
+
+  return layout;
+}
+
+/**
+ * @brief Packs a single arithmetic value
+ *
+ * @param destination  The destination pointer, advanced past the value
+ * @param value        The value
+ */
+template <typename T>
+inline void pack_value(char*& destination, T value) {
+  static_assert(std::is_arithmetic_v<T>, "only arithmetic values are packed");
+  std::memcpy(destination, &value, sizeof(value));
+  destination += sizeof(value);
+}
+
+/**
+ * @brief Reads a single value of a given channel type from a raw record
+ *
+ * @param  source  The source pointer, advanced past the value
+ * @param  type    The channel type
+ * @param  visitor A callable taking any arithmetic value
+ */
+template <typename Visitor>
+inline void unpack_value(const char*& source, channel_type type,
+                         Visitor&& visitor) {
+  auto read = [&source, &visitor](auto tag) {
+    decltype(tag) value;
+    std::memcpy(&value, source, sizeof(value));
+    source += sizeof(value);
+    visitor(value);
+  };
+
+  switch (type) {
+    case channel_type::u8: read(std::uint8_t{}); break;
+    case channel_type::u16: read(std::uint16_t{}); break;
+    case channel_type::u32: read(std::uint32_t{}); break;
+    case channel_type::u64: read(std::uint64_t{}); break;
+    case channel_type::i8: read(std::int8_t{}); break;
+    case channel_type::i16: read(std::int16_t{}); break;
+    case channel_type::i32: read(std::int32_t{}); break;
+    case channel_type::i64: read(std::int64_t{}); break;
+    case channel_type::f32: read(float{}); break;
+    case channel_type::f64: read(double{}); break;
+  }
+}
+
+}  // namespace exot::apps::utilities
@@ -0,0 +1,232 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/channels.h
+ * @author     Bruno Klopott
+ * @brief      Flattening of meter module readings into typed scalar channels.
+ *
+ * Meter modules return values of various shapes: plain arithmetic values,
+ * iterables (usually one value per core), tuples, or nested combinations of
+ * these. The utilities in this file visit such values in a fixed order, which
+ * allows describing each reading as a flat list of typed channels.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <exot/utilities/types.h>
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief The type of a single scalar channel, as stored in binary outputs
+ */
+enum class channel_type : std::uint8_t {
+  u8  = 0x01,
+  u16 = 0x02,
+  u32 = 0x03,
+  u64 = 0x04,
+  i8  = 0x11,
+  i16 = 0x12,
+  i32 = 0x13,
+  i64 = 0x14,
+  f32 = 0x21,
+  f64 = 0x22,
+};
+
+/**
+ * @brief Gets the size in bytes of a channel type
+ */
+constexpr inline std::size_t channel_size(channel_type type) {
+  switch (type) {
+    case channel_type::u8:
+    case channel_type::i8: return 1;
+    case channel_type::u16:
+    case channel_type::i16: return 2;
+    case channel_type::u32:
+    case channel_type::i32:
+    case channel_type::f32: return 4;
+    default: return 8;
+  }
+}
+
+/**
+ * @brief Gets a short name of a channel type, e.g. "u64"
+ */
+inline const char* channel_type_name(channel_type type) {
+  switch (type) {
+    case channel_type::u8: return "u8";
+    case channel_type::u16: return "u16";
+    case channel_type::u32: return "u32";
+    case channel_type::u64: return "u64";
+    case channel_type::i8: return "i8";
+    case channel_type::i16: return "i16";
+    case channel_type::i32: return "i32";
+    case channel_type::i64: return "i64";
+    case channel_type::f32: return "f32";
+    case channel_type::f64: return "f64";
+    default: return "unknown";
+  }
+}
+
+/**
+ * @brief Checks if a raw value is a valid channel type
+ */
+inline bool is_valid_channel_type(std::uint8_t value) {
+  switch (static_cast<channel_type>(value)) {
+    case channel_type::u8:
+    case channel_type::u16:
+    case channel_type::u32:
+    case channel_type::u64:
+    case channel_type::i8:
+    case channel_type::i16:
+    case channel_type::i32:
+    case channel_type::i64:
+    case channel_type::f32:
+    case channel_type::f64: return true;
+    default: return false;
+  }
+}
+
+namespace details {
+template <typename T>
+struct is_tuple_like : std::false_type {};
+template <typename... Ts>
+struct is_tuple_like<std::tuple<Ts...>> : std::true_type {};
+template <typename T, typename U>
+struct is_tuple_like<std::pair<T, U>> : std::true_type {};
+
+template <typename T>
+struct is_duration : std::false_type {};
+template <typename Rep, typename Period>
+struct is_duration<std::chrono::duration<Rep, Period>> : std::true_type {};
+}  // namespace details
+
+/**
+ * @brief Maps an arithmetic type to its channel type
+ */
+template <typename T, typename = void>
+struct channel_type_of;
+
+template <typename T>
+struct channel_type_of<T, std::enable_if_t<std::is_integral_v<T>>> {
+  static constexpr channel_type value = static_cast<channel_type>(
+      (std::is_signed_v<T> ? 0x10 : 0x00) |
+      (sizeof(T) == 1 ? 1 : sizeof(T) == 2 ? 2 : sizeof(T) == 4 ? 3 : 4));
+};
+
+template <typename T>
+struct channel_type_of<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+  static constexpr channel_type value =
+      sizeof(T) <= 4 ? channel_type::f32 : channel_type::f64;
+};
+
+/**
+ * @brief Visits all scalar values contained in a meter reading
+ *
+ * @note  Durations are visited as their tick count, booleans as uint8.
+ *
+ * @param value    The reading
+ * @param visitor  A callable taking any arithmetic value
+ */
+template <typename T, typename Visitor>
+inline void visit_channels(const T& value, Visitor&& visitor) {
+  using type = std::decay_t<T>;
+
+  if constexpr (std::is_same_v<type, bool>) {
+    visitor(static_cast<std::uint8_t>(value));
+  } else if constexpr (std::is_arithmetic_v<type>) {
+    visitor(value);
+  } else if constexpr (details::is_duration<type>::value) {
+    visitor(value.count());
+  } else if constexpr (details::is_tuple_like<type>::value) {
+    std::apply(
+        [&visitor](const auto&... elements) {
+          (visit_channels(elements, visitor), ...);
+        },
+        value);
+  } else if constexpr (exot::utilities::is_iterable_v<type>) {
+    for (const auto& element : value) visit_channels(element, visitor);
+  } else {
+    static_assert(std::is_arithmetic_v<type>,
+                  "meter readings must be composed of arithmetic values, "
+                  "durations, tuples, and iterables thereof");
+  }
+}
+
+/**
+ * @brief Counts the scalar channels contained in a meter reading
+ */
+template <typename T>
+inline std::size_t count_channels(const T& value) {
+  std::size_t count{0};
+  visit_channels(value, [&count](auto) { ++count; });
+  return count;
+}
+
+/**
+ * @brief Holds the name and type of a single channel
+ */
+struct channel_description {
+  std::string name;
+  channel_type type;
+};
+
+/**
+ * @brief Appends channel descriptions of a reading to a container
+ *
+ * @param value   The reading
+ * @param names   The header provided by the module; if it does not match the
+ *                number of channels, names are generated from the prefix
+ * @param prefix  The prefix used for generated names
+ * @param out     The output container
+ */
+template <typename T, typename Names, typename Container>
+inline void describe_channels(const T& value, const Names& names,
+                              const std::string& prefix, Container& out) {
+  auto use_names = count_channels(value) == std::size(names);
+  auto it        = std::begin(names);
+  std::size_t index{0};
+
+  visit_channels(value, [&](auto scalar) {
+    using scalar_type = std::decay_t<decltype(scalar)>;
+    out.push_back(
+        {use_names ? std::string{*it++} : prefix + ":" + std::to_string(index),
+         channel_type_of<scalar_type>::value});
+    ++index;
+  });
+}
+
+}  // namespace exot::apps::utilities
@@ -0,0 +1,113 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/deadline.h
+ * @author     Bruno Klopott
+ * @brief      Waiting for absolute deadlines on the monotonic clock.
+ */
+
+#pragma once
+
+#include <time.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief Gets the monotonic time in nanoseconds
+ * @note  Uses the same clock as std::chrono::steady_clock on Linux.
+ */
+inline std::int64_t monotonic_ns() {
+  struct ::timespec now;
+  ::clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<std::int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief Hints the processor that the caller is spin-waiting
+ */
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+/**
+ * @brief Waits until an absolute deadline on the monotonic clock
+ * @details Sleeps with clock_nanosleep and TIMER_ABSTIME until shortly
+ *          before the deadline, and spins for the remaining time, which
+ *          hides the wake-up latency of the sleep. Deadlines in the past
+ *          return immediately, such that a late caller catches up with the
+ *          schedule rather than drifting behind it.
+ *
+ * @param deadline The deadline in nanoseconds on the monotonic clock
+ * @param spin     The time spent spinning before the deadline, in ns
+ */
+inline void wait_until_ns(std::int64_t deadline, std::int64_t spin) {
+  auto wake = deadline - spin;
+  if (monotonic_ns() < wake) {
+    struct ::timespec until;
+    until.tv_sec  = static_cast<::time_t>(wake / 1000000000);
+    until.tv_nsec = static_cast<long>(wake % 1000000000);
+    while (::clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until,
+                             nullptr) == EINTR) {}
+  }
+
+  while (monotonic_ns() < deadline) cpu_relax();
+}
+
+/**
+ * @brief Running statistics of how late events happen
+ */
+struct lateness_statistics {
+  std::uint64_t count{0};
+  std::int64_t sum{0};
+  std::int64_t min{std::numeric_limits<std::int64_t>::max()};
+  std::int64_t max{std::numeric_limits<std::int64_t>::min()};
+
+  void add(std::int64_t lateness) {
+    ++count;
+    sum += lateness;
+    min = std::min(min, lateness);
+    max = std::max(max, lateness);
+  }
+
+  double mean() const {
+    return count ? static_cast<double>(sum) / count : 0.0;
+  }
+};
+
+}  // namespace exot::apps::utilities
@@ -0,0 +1,258 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/delta_encoding.h
+ * @author     Bruno Klopott
+ * @brief      Per-column delta and zig-zag varint coding of raw records.
+ *
+ * Each column of a record, including the timestamp, is coded relative to the
+ * same column of the previously coded record. Integer columns store the
+ * difference, zig-zag mapped to an unsigned value; floating-point columns
+ * store the XOR of the bit patterns with its bytes reversed. The result is
+ * written as a LEB128 varint, such that slowly changing values take a single
+ * byte. The first record is coded relative to an all-zero record.
+ *
+ * Similar floating-point values share the sign, the exponent and the high
+ * mantissa bits, so their XOR has leading zeros but its low bytes carry the
+ * differing mantissa bits. Reversing the bytes moves these to the top and
+ * the zeros to the bottom, where the varint drops them, e.g. 45.0 to 46.0
+ * takes 4 bytes rather than 7 as a double and 2 rather than 3 as a float.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <exot/apps/utilities/binary_format.h>
+#include <exot/apps/utilities/channels.h>
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief The maximum length of a 64-bit LEB128 varint
+ */
+inline constexpr std::size_t max_varint_size = 10;
+
+inline char* write_varint(char* out, std::uint64_t value) {
+  while (value >= 0x80) {
+    *out++ = static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  *out++ = static_cast<char>(value);
+  return out;
+}
+
+inline std::uint64_t zigzag(std::int64_t value) {
+  return (static_cast<std::uint64_t>(value) << 1) ^
+         static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t value) {
+  return static_cast<std::int64_t>(value >> 1) ^
+         -static_cast<std::int64_t>(value & 1);
+}
+
+namespace details {
+
+/**
+ * @brief Reads a column as a 64-bit pattern
+ * @details Signed integers are sign-extended, floating-point values are
+ *          reinterpreted, such that differences and XORs are well-defined.
+ */
+inline std::uint64_t load_column(const char* source, channel_type type) {
+  auto out = std::uint64_t{0};
+  unpack_value(source, type, [&out](auto value) {
+    using type = decltype(value);
+    if constexpr (std::is_floating_point_v<type>) {
+      if constexpr (sizeof(type) == 4) {
+        auto bits = std::uint32_t{};
+        std::memcpy(&bits, &value, sizeof(bits));
+        out = bits;
+      } else {
+        std::memcpy(&out, &value, sizeof(out));
+      }
+    } else if constexpr (std::is_signed_v<type>) {
+      out = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+    } else {
+      out = static_cast<std::uint64_t>(value);
+    }
+  });
+  return out;
+}
+
+/**
+ * @brief Writes the low bytes of a 64-bit pattern as a column
+ */
+inline void store_column(char* destination, channel_type type,
+                         std::uint64_t bits) {
+  std::memcpy(destination, &bits, channel_size(type));
+}
+
+inline bool is_float(channel_type type) {
+  return type == channel_type::f32 || type == channel_type::f64;
+}
+
+/**
+ * @brief Reverses the bytes of a floating-point column's bit pattern
+ * @note  The reversal is its own inverse, encoding and decoding share it.
+ */
+inline std::uint64_t reverse_float(std::uint64_t bits, channel_type type) {
+  return type == channel_type::f32
+             ? __builtin_bswap32(static_cast<std::uint32_t>(bits))
+             : __builtin_bswap64(bits);
+}
+
+}  // namespace details
+
+/**
+ * @brief Codes the columns of a record layout, including the timestamp
+ */
+inline std::vector<channel_type> record_columns(const binary_layout& layout) {
+  auto columns = std::vector<channel_type>{channel_type::i64};
+  for (const auto& channel : layout.channels) columns.push_back(channel.type);
+  return columns;
+}
+
+/**
+ * @brief Encodes raw records into delta-coded records
+ */
+class delta_encoder {
+ public:
+  explicit delta_encoder(const binary_layout& layout)
+      : columns_{record_columns(layout)},
+        previous_(layout.record_size(), 0),
+        candidate_(layout.record_size(), 0) {}
+
+  /**
+   * @brief The maximum size of a single encoded record
+   */
+  std::size_t max_encoded_size() const {
+    return columns_.size() * max_varint_size;
+  }
+
+  /**
+   * @brief Encodes a raw record relative to the last committed one
+   *
+   * @param  raw  The raw record
+   * @param  out  The output, at least max_encoded_size() bytes long
+   * @return The size of the encoded record
+   */
+  std::size_t encode(const char* raw, char* out) {
+    auto* begin = out;
+    auto offset = std::size_t{0};
+
+    for (auto type : columns_) {
+      auto current  = details::load_column(raw + offset, type);
+      auto previous = details::load_column(previous_.data() + offset, type);
+
+      auto coded = details::is_float(type)
+                       ? details::reverse_float(current ^ previous, type)
+                       : zigzag(static_cast<std::int64_t>(current - previous));
+      out = write_varint(out, coded);
+      offset += channel_size(type);
+    }
+
+    std::memcpy(candidate_.data(), raw, candidate_.size());
+    return static_cast<std::size_t>(out - begin);
+  }
+
+  /**
+   * @brief Makes the last encoded record the reference for the next one
+   * @note  Only commit records that reached the output; a dropped record must
+   *        not become the reference, otherwise decoding goes out of sync.
+   */
+  void commit() { previous_.swap(candidate_); }
+
+ private:
+  std::vector<channel_type> columns_;
+  std::vector<char> previous_;
+  std::vector<char> candidate_;
+};
+
+/**
+ * @brief Decodes delta-coded records into raw records
+ */
+class delta_decoder {
+ public:
+  explicit delta_decoder(const binary_layout& layout)
+      : columns_{record_columns(layout)},
+        previous_(layout.record_size(), 0) {}
+
+  /**
+   * @brief Decodes a single record
+   *
+   * @param  next_byte  A callable returning the next input byte as an int,
+   *                    or a negative value at the end of input
+   * @param  raw        The output raw record, record_size() bytes long
+   * @return False if the input ended before the record, true otherwise
+   */
+  template <typename NextByte>
+  bool decode(NextByte&& next_byte, char* raw) {
+    auto offset = std::size_t{0};
+
+    for (auto i = 0u; i < columns_.size(); ++i) {
+      auto type  = columns_[i];
+      auto coded = std::uint64_t{0};
+
+      for (auto shift = 0u;; shift += 7) {
+        auto byte = next_byte();
+        if (byte < 0) {
+          if (i == 0 && shift == 0) return false;
+          throw std::runtime_error("truncated delta-coded record");
+        }
+        if (shift >= 64) throw std::runtime_error("invalid varint");
+
+        coded |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) break;
+      }
+
+      auto previous = details::load_column(previous_.data() + offset, type);
+      auto current =
+          details::is_float(type)
+              ? details::reverse_float(coded, type) ^ previous
+              : previous + static_cast<std::uint64_t>(unzigzag(coded));
+
+      details::store_column(raw + offset, type, current);
+      offset += channel_size(type);
+    }
+
+    std::memcpy(previous_.data(), raw, previous_.size());
+    return true;
+  }
+
+ private:
+  std::vector<channel_type> columns_;
+  std::vector<char> previous_;
+};
+
+}  // namespace exot::apps::utilities
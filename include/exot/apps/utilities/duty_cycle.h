@@ -0,0 +1,96 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/duty_cycle.h
+ * @author     Bruno Klopott
+ * @brief      Running load kernels for a fraction of fixed periods.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include <exot/apps/utilities/deadline.h>
+#include <exot/apps/utilities/load_kernels.h>
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief Runs a load kernel for a fraction of every period while a flag
+ *        is set, and sleeps for the rest of the period
+ * @details Sleeps are split into slices of at most 100 us, such that a
+ *          cleared flag is noticed promptly. If a period overruns, e.g.
+ *          because the thread was preempted, the cycle restarts from the
+ *          current time rather than trying to catch up.
+ *
+ * @param flag      The enable flag, an atomic boolean
+ * @param period    The period in nanoseconds
+ * @param batch     The work items executed between time checks
+ * @param context   The kernel context of the calling thread
+ * @param select    Callable returning the duty in [0, 1] and the kernel to
+ *                  use, called at the start of every period
+ * @param on_period Callable invoked after the busy phase of every period
+ */
+template <typename Flag, typename Select, typename OnPeriod>
+inline void run_duty_cycle(const Flag& flag, std::int64_t period,
+                           std::size_t batch, kernel_context& context,
+                           Select&& select, OnPeriod&& on_period) {
+  const auto slice = std::min<std::int64_t>(period, 100000);
+  auto start       = monotonic_ns();
+  auto sink        = std::uint64_t{0};
+
+  while (flag.load(std::memory_order_acquire)) {
+    auto [duty, kernel] = select();
+    auto busy           = static_cast<std::int64_t>(duty * period);
+
+    auto now = monotonic_ns();
+    while (now - start < busy && flag.load(std::memory_order_relaxed)) {
+      sink ^= kernel(context, batch);
+      now = monotonic_ns();
+    }
+
+    start += period;
+    on_period();
+
+    now = monotonic_ns();
+    while (now < start && flag.load(std::memory_order_relaxed)) {
+      wait_until_ns(std::min(start, now + slice), 0);
+      now = monotonic_ns();
+    }
+
+    if (now - start > period) start = now;
+  }
+
+  asm volatile("" : : "r"(sink));
+}
+
+}  // namespace exot::apps::utilities
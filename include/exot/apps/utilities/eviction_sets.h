@@ -0,0 +1,426 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/eviction_sets.h
+ * @author     Bruno Klopott
+ * @brief      Construction of last-level cache eviction sets on hugepages,
+ *             and their persistence across runs.
+ *
+ * Eviction sets are reduced from a pool of candidate lines with the group
+ * testing algorithm (Vila et al., "Theory and Practice of Finding Eviction
+ * Sets", S&P 2019), which needs O(ways^2 * candidates) memory accesses
+ * instead of the O(candidates^2) of the baseline reduction.
+ *
+ * Since cache sets and slices are determined by physical addresses, found
+ * sets are only valid for the same physical pages. Sets are cached in a
+ * directory, in files named after a hash of the CPU model and the physical
+ * frames backing the buffer, such that a run which obtains the same
+ * hugepages (e.g. a pool reserved at boot) loads them instead of searching.
+ * Physical frames are read from /proc/self/pagemap, which requires
+ * CAP_SYS_ADMIN; without it, sets are constructed but not cached.
+ *
+ * Construction tells cached from uncached loads with the timestamp counter
+ * and is only supported on x86_64. The generic timer of aarch64 ticks too
+ * slowly to resolve a single load, and constructing a finder there throws.
+ * Cached sets can nevertheless be used on any platform.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <exot/primitives/cache.h>
+
+#if defined(__x86_64__)
+#include <exot/primitives/tsc.h>
+#include <exot/utilities/timing.h>
+#define EXOT_APPS_HAVE_EVICTION_SETS 1
+#endif
+
+namespace exot::apps::utilities {
+
+using eviction_set = std::vector<std::uint32_t>;  //! offsets in a buffer
+
+/* Can eviction sets be constructed on this platform? */
+#if defined(EXOT_APPS_HAVE_EVICTION_SETS)
+inline constexpr bool eviction_sets_supported = true;
+#else
+inline constexpr bool eviction_sets_supported = false;
+#endif
+
+/**
+ * @brief Gets lines at a stride from a target, which map to the same set
+ *        of an unsliced cache
+ */
+inline eviction_set strided_set(std::uint32_t target, std::size_t stride,
+                                unsigned ways) {
+  eviction_set lines;
+  for (auto k = 0u; k < ways; ++k)
+    lines.push_back(static_cast<std::uint32_t>(target + k * stride));
+  return lines;
+}
+
+namespace details {
+
+/**
+ * @brief Measures the latency of a load in timestamp counter ticks
+ */
+inline std::uint64_t time_access(void* address) {
+#if defined(EXOT_APPS_HAVE_EVICTION_SETS)
+  return exot::utilities::timeit<exot::primitives::MemoryFencedTSC>(
+      exot::primitives::access_read<>, address);
+#else
+  (void)address;
+  return 0;  //! not reached, the finder rejects such platforms
+#endif
+}
+
+inline std::uint64_t fnv1a(const std::string& data) {
+  auto hash = std::uint64_t{0xcbf29ce484222325ull};
+  for (auto c : data) {
+    hash ^= static_cast<std::uint8_t>(c);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+}  // namespace details
+
+/**
+ * @brief Gets the CPU model name from /proc/cpuinfo
+ */
+inline std::string cpu_model() {
+  std::ifstream file{"/proc/cpuinfo"};
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.compare(0, 10, "model name") == 0 ||
+        line.compare(0, 8, "CPU part") == 0) {
+      auto colon = line.find(':');
+      if (colon != std::string::npos) return line.substr(colon + 2);
+    }
+  }
+  return "unknown";
+}
+
+/**
+ * @brief Gets the physical frame number backing a virtual address
+ * @return The frame, or nullopt if unavailable to the process
+ */
+inline std::optional<std::uint64_t> physical_frame(const void* address) {
+  auto fd = ::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return std::nullopt;
+
+  auto page  = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+  auto index = reinterpret_cast<std::uintptr_t>(address) / page;
+  std::uint64_t entry{0};
+  auto length = ::pread(fd, &entry, sizeof(entry), index * sizeof(entry));
+  ::close(fd);
+
+  auto frame = entry & ((std::uint64_t{1} << 55) - 1);
+  auto present = (entry >> 63) & 1;
+  if (length != sizeof(entry) || !present || frame == 0) return std::nullopt;
+  return frame;
+}
+
+/**
+ * @brief Makes the cache key of a buffer from the CPU model and the
+ *        physical frames of its pages
+ * @return The key, or nullopt if physical frames are unavailable
+ */
+inline std::optional<std::string> eviction_cache_key(const std::uint8_t* base,
+                                                     std::size_t size,
+                                                     std::size_t page_size) {
+  auto key = fmt::format("{}|{}", cpu_model(), page_size);
+  for (std::size_t offset = 0; offset < size; offset += page_size) {
+    auto frame = physical_frame(base + offset);
+    if (!frame) return std::nullopt;
+    key += fmt::format("|{:x}", *frame);
+  }
+  return key;
+}
+
+/**
+ * @brief Eviction sets indexed by target offset, persisted in a directory
+ */
+class eviction_cache {
+ public:
+  eviction_cache(std::string directory, std::string key)
+      : key_{std::move(key)},
+        path_{fmt::format("{}/{:016x}.evs", directory, details::fnv1a(key_))} {
+    std::ifstream file{path_};
+    std::string line;
+    if (!std::getline(file, line) || line != key_) return;
+
+    while (std::getline(file, line)) {
+      std::istringstream stream{line};
+      std::uint32_t target, offset;
+      if (!(stream >> target)) continue;
+      auto& set = sets_[target];
+      while (stream >> offset) set.push_back(offset);
+    }
+  }
+
+  const eviction_set* find(std::uint32_t target) const {
+    auto it = sets_.find(target);
+    return it != sets_.end() ? &it->second : nullptr;
+  }
+
+  void insert(std::uint32_t target, eviction_set set) {
+    sets_[target] = std::move(set);
+    dirty_        = true;
+  }
+
+  /**
+   * @brief Writes the sets if any were added
+   * @return False if writing failed
+   */
+  bool save() {
+    if (!dirty_) return true;
+
+    std::ofstream file{path_, std::ios::trunc};
+    file << key_ << '\n';
+    for (const auto& [target, set] : sets_) {
+      file << target;
+      for (auto offset : set) file << ' ' << offset;
+      file << '\n';
+    }
+
+    dirty_ = !file.good();
+    return !dirty_;
+  }
+
+  std::size_t size() const { return sets_.size(); }
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string key_;
+  std::string path_;
+  std::map<std::uint32_t, eviction_set> sets_;
+  bool dirty_{false};
+};
+
+/**
+ * @brief Finds minimal eviction sets among lines of a buffer
+ */
+class eviction_set_finder {
+ public:
+  /**
+   * @param base    The buffer
+   * @param size    The size of the buffer
+   * @param stride  The distance between candidate lines of a target
+   * @param ways    The associativity, i.e. the size of a minimal set
+   * @param threshold The latency above which a load is a miss, calibrated
+   *                  if zero
+   */
+  eviction_set_finder(std::uint8_t* base, std::size_t size,
+                      std::size_t stride, unsigned ways,
+                      std::uint64_t threshold = 0)
+      : base_{base}, size_{size}, stride_{stride}, ways_{ways} {
+    if (!eviction_sets_supported)
+      throw std::logic_error(
+          "eviction sets can only be constructed on x86_64");
+    threshold_ = threshold != 0 ? threshold : calibrate();
+  }
+
+  /**
+   * @brief Finds an eviction set for the line at an offset
+   * @return The offsets of the set, or nullopt if no set was found
+   */
+  std::optional<eviction_set> find(std::uint32_t target) const {
+    std::vector<std::uint32_t> candidates;
+    for (auto offset = static_cast<std::size_t>(target) % stride_;
+         offset < size_; offset += stride_)
+      if (offset != target)
+        candidates.push_back(static_cast<std::uint32_t>(offset));
+
+    if (!evicts(target, candidates)) return std::nullopt;
+
+    // group testing: remove one of (ways + 1) groups whenever the rest
+    // still evicts the target; one such group always exists
+    std::vector<std::uint32_t> rest;
+    while (candidates.size() > ways_) {
+      auto groups  = std::min<std::size_t>(ways_ + 1, candidates.size());
+      auto removed = false;
+
+      for (std::size_t g = 0; g < groups && !removed; ++g) {
+        auto begin = candidates.size() * g / groups;
+        auto end   = candidates.size() * (g + 1) / groups;
+
+        rest.clear();
+        rest.insert(rest.end(), candidates.begin(), candidates.begin() + begin);
+        rest.insert(rest.end(), candidates.begin() + end, candidates.end());
+
+        if (evicts(target, rest)) {
+          candidates.swap(rest);
+          removed = true;
+        }
+      }
+
+      if (!removed) return std::nullopt;
+    }
+
+    return candidates;
+  }
+
+  std::uint64_t threshold() const { return threshold_; }
+
+ private:
+  /**
+   * @brief Tests if traversing a set evicts the target, by majority vote
+   */
+  bool evicts(std::uint32_t target, const std::vector<std::uint32_t>& set,
+              unsigned rounds = 7) const {
+    auto misses = 0u;
+    for (auto round = 0u; round < rounds; ++round) {
+      exot::primitives::access_read<>(base_ + target);
+      for (auto offset : set) exot::primitives::access_read<>(base_ + offset);
+      for (auto it = set.rbegin(); it != set.rend(); ++it)
+        exot::primitives::access_read<>(base_ + *it);
+      if (details::time_access(base_ + target) > threshold_) ++misses;
+    }
+    return misses * 2 > rounds;
+  }
+
+  /**
+   * @brief Places the threshold between cached and flushed load latencies
+   * @details The threshold lies at 3/4 of the distance from the median
+   *          cached latency to the median flushed latency, such that loads
+   *          served by the last-level cache count as hits.
+   */
+  std::uint64_t calibrate() const {
+    constexpr auto samples = 1001;
+    std::vector<std::uint64_t> hits, misses;
+    auto* line = base_;
+
+    for (auto i = 0; i < samples; ++i) {
+      exot::primitives::access_read<>(line);
+      hits.push_back(details::time_access(line));
+      exot::primitives::flush(line);
+      misses.push_back(details::time_access(line));
+    }
+
+    std::nth_element(hits.begin(), hits.begin() + samples / 2, hits.end());
+    std::nth_element(misses.begin(), misses.begin() + samples / 2,
+                     misses.end());
+    auto hit  = hits[samples / 2];
+    auto miss = std::max(misses[samples / 2], hit + 1);
+    return hit + (miss - hit) * 3 / 4;
+  }
+
+  std::uint8_t* base_;
+  std::size_t size_;
+  std::size_t stride_;
+  unsigned ways_;
+  std::uint64_t threshold_;
+};
+
+/**
+ * @brief Eviction sets of a buffer, loaded from a cache directory where
+ *        possible and constructed otherwise
+ * @details The finder, and with it the calibration of the threshold, is
+ *          only created once a set is missing from the cache, such that
+ *          fully cached runs perform no timing at all.
+ */
+class eviction_set_store {
+ public:
+  /**
+   * @param base      The buffer
+   * @param size      The size of the buffer
+   * @param page_size The size of the pages backing the buffer
+   * @param stride    The distance between candidate lines of a target
+   * @param ways      The associativity, i.e. the size of a minimal set
+   * @param threshold The miss latency threshold, calibrated if zero
+   * @param directory The cache directory, no caching if empty
+   */
+  eviction_set_store(std::uint8_t* base, std::size_t size,
+                     std::size_t page_size, std::size_t stride, unsigned ways,
+                     std::uint64_t threshold, const std::string& directory)
+      : base_{base},
+        size_{size},
+        stride_{stride},
+        ways_{ways},
+        threshold_{threshold} {
+    if (directory.empty()) return;
+    auto key = eviction_cache_key(base, size, page_size);
+    if (key) cache_ = std::make_unique<eviction_cache>(directory, *key);
+  }
+
+  /**
+   * @brief Gets the eviction set of a target, constructing it if missing
+   * @return The offsets of the set, or nullopt if none was found
+   */
+  std::optional<eviction_set> get(std::uint32_t target) {
+    if (cache_) {
+      if (auto* cached = cache_->find(target)) return *cached;
+    }
+
+    if (!finder_)
+      finder_ = std::make_unique<eviction_set_finder>(base_, size_, stride_,
+                                                      ways_, threshold_);
+
+    auto found = finder_->find(target);
+    if (found && cache_) cache_->insert(target, *found);
+    return found;
+  }
+
+  /**
+   * @brief Writes newly constructed sets to the cache
+   * @return False if writing failed
+   */
+  bool save() { return cache_ ? cache_->save() : true; }
+
+  /* The cache, or nullptr if physical addresses are unavailable */
+  const eviction_cache* cache() const { return cache_.get(); }
+
+ private:
+  std::uint8_t* base_;
+  std::size_t size_;
+  std::size_t stride_;
+  unsigned ways_;
+  std::uint64_t threshold_;
+  std::unique_ptr<eviction_cache> cache_;
+  std::unique_ptr<eviction_set_finder> finder_;
+};
+
+}  // namespace exot::apps::utilities
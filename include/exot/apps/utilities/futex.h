@@ -0,0 +1,121 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/futex.h
+ * @author     Bruno Klopott
+ * @brief      A generation counter which threads can wait on without locks.
+ */
+
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+
+#include <exot/apps/utilities/deadline.h>
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief A counter advanced by one thread and awaited by others
+ * @details Waiters spin for a while, which catches advances that follow
+ *          shortly without any system call, and then sleep on a futex. The
+ *          advancing thread only issues a wake-up if a waiter is asleep.
+ */
+class generation_counter {
+ public:
+  std::uint32_t load() const {
+    return value_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Increments the generation and wakes sleeping waiters
+   * @details Stores of the caller before the advance are visible to the
+   *          waiters which observe the new generation.
+   */
+  void advance() {
+    value_.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) != 0)
+      ::syscall(SYS_futex, word(), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr,
+                nullptr, 0);
+  }
+
+  /**
+   * @brief Waits until the generation differs from a seen one
+   *
+   * @param seen    The last generation seen by the caller
+   * @param spin    The time spent spinning before sleeping, in ns
+   * @param timeout The longest time spent asleep, in ns, unlimited if 0
+   * @return The new generation, or the seen one if the timeout expired
+   */
+  std::uint32_t wait(std::uint32_t seen, std::int64_t spin,
+                     std::int64_t timeout = 0) {
+    auto until = monotonic_ns() + spin;
+    for (auto i = 0u;; ++i) {
+      auto current = value_.load(std::memory_order_acquire);
+      if (current != seen) return current;
+      // the clock is only read every few iterations to keep the spin tight
+      if ((i & 63u) == 63u && monotonic_ns() >= until) break;
+      cpu_relax();
+    }
+
+    struct ::timespec limit;
+    limit.tv_sec  = static_cast<::time_t>(timeout / 1000000000);
+    limit.tv_nsec = static_cast<long>(timeout % 1000000000);
+
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    auto current = value_.load(std::memory_order_seq_cst);
+    while (current == seen) {
+      ::syscall(SYS_futex, word(), FUTEX_WAIT_PRIVATE, seen,
+                timeout > 0 ? &limit : nullptr, nullptr, 0);
+      current = value_.load(std::memory_order_seq_cst);
+      // a bounded wait returns after a single sleep, callers retry
+      if (timeout > 0) break;
+    }
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+
+    return current;
+  }
+
+ private:
+  std::uint32_t* word() { return reinterpret_cast<std::uint32_t*>(&value_); }
+
+  static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+                "futex words must be 32-bit");
+
+  std::atomic<std::uint32_t> value_{0};
+  std::atomic<std::uint32_t> sleepers_{0};
+};
+
+}  // namespace exot::apps::utilities
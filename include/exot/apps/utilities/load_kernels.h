@@ -0,0 +1,234 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/load_kernels.h
+ * @author     Bruno Klopott
+ * @brief      Load kernels exercising different execution units, selected
+ *             at runtime depending on the features of the CPU.
+ *
+ * Each kernel executes a batch of independent work items and returns a
+ * value depending on all of them, such that the work cannot be optimised
+ * away. Vector kernels are compiled for their instruction sets with target
+ * attributes, such that a single binary contains all kernels available on
+ * its architecture, and only runs those supported by the CPU.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief Per-thread state of a load kernel
+ */
+struct kernel_context {
+  explicit kernel_context(std::size_t stream_bytes = 0)
+      : stream(stream_bytes / sizeof(double), 1.0) {}
+
+  std::vector<double> stream;  //! buffer of the streaming kernel
+  std::size_t position{0};     //! position in the stream buffer
+};
+
+using load_kernel = std::uint64_t (*)(kernel_context&, std::size_t);
+
+namespace kernels {
+
+/**
+ * @brief Integer multiply-xorshift chains on the scalar ALUs
+ */
+inline std::uint64_t scalar(kernel_context&, std::size_t items) {
+  std::uint64_t a = 0x9e3779b97f4a7c15ull, b = 0xbf58476d1ce4e5b9ull;
+  std::uint64_t c = 0x94d049bb133111ebull, d = 0x2545f4914f6cdd1dull;
+  for (std::size_t i = 0; i < items; ++i) {
+    a = (a ^ (a >> 31)) * 0xd6e8feb86659fd93ull;
+    b = (b ^ (b >> 29)) * 0xd6e8feb86659fd93ull;
+    c = (c ^ (c >> 27)) * 0xd6e8feb86659fd93ull;
+    d = (d ^ (d >> 25)) * 0xd6e8feb86659fd93ull;
+    asm volatile("" : "+r"(a), "+r"(b), "+r"(c), "+r"(d));
+  }
+  return a ^ b ^ c ^ d;
+}
+
+/**
+ * @brief Streams through a buffer larger than the caches
+ * @details Each work item reads and writes one cache line.
+ */
+inline std::uint64_t stream(kernel_context& context, std::size_t items) {
+  auto& buffer        = context.stream;
+  constexpr auto line = 64 / sizeof(double);
+  if (buffer.size() < line) return 0;
+
+  double sum = 0.0;
+  for (std::size_t i = 0; i < items; ++i) {
+    if (context.position + line > buffer.size()) context.position = 0;
+    auto* data = buffer.data() + context.position;
+    for (std::size_t j = 0; j < line; ++j) {
+      sum += data[j];
+      data[j] = data[j] * 0.5 + 0.5;
+    }
+    context.position += line;
+  }
+  return static_cast<std::uint64_t>(sum);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * @brief Independent packed multiply-add chains on 128-bit SSE2 registers
+ */
+__attribute__((target("sse2"))) inline std::uint64_t sse(kernel_context&,
+                                                         std::size_t items) {
+  auto m = _mm_set1_pd(0.999999), k = _mm_set1_pd(1e-7);
+  __m128d r[8];
+  for (auto& v : r) v = _mm_set1_pd(1.0);
+  for (std::size_t i = 0; i < items; ++i) {
+    for (auto& v : r) v = _mm_add_pd(_mm_mul_pd(v, m), k);
+    asm volatile("" : "+x"(r[0]), "+x"(r[1]), "+x"(r[2]), "+x"(r[3]));
+  }
+  for (int j = 1; j < 8; ++j) r[0] = _mm_add_pd(r[0], r[j]);
+  return static_cast<std::uint64_t>(_mm_cvtsd_f64(r[0]));
+}
+
+/**
+ * @brief Independent fused multiply-add chains on 256-bit AVX2 registers
+ */
+__attribute__((target("avx2,fma"))) inline std::uint64_t avx2(
+    kernel_context&, std::size_t items) {
+  auto m = _mm256_set1_pd(0.999999), k = _mm256_set1_pd(1e-7);
+  __m256d r[10];
+  for (auto& v : r) v = _mm256_set1_pd(1.0);
+  for (std::size_t i = 0; i < items; ++i) {
+    for (auto& v : r) v = _mm256_fmadd_pd(v, m, k);
+    asm volatile("" : "+x"(r[0]), "+x"(r[1]), "+x"(r[2]), "+x"(r[3]));
+  }
+  for (int j = 1; j < 10; ++j) r[0] = _mm256_add_pd(r[0], r[j]);
+  return static_cast<std::uint64_t>(
+      _mm_cvtsd_f64(_mm256_castpd256_pd128(r[0])));
+}
+
+/**
+ * @brief Independent fused multiply-add chains on 512-bit AVX-512 registers
+ */
+__attribute__((target("avx512f"))) inline std::uint64_t avx512(
+    kernel_context&, std::size_t items) {
+  auto m = _mm512_set1_pd(0.999999), k = _mm512_set1_pd(1e-7);
+  __m512d r[10];
+  for (auto& v : r) v = _mm512_set1_pd(1.0);
+  for (std::size_t i = 0; i < items; ++i) {
+    for (auto& v : r) v = _mm512_fmadd_pd(v, m, k);
+    asm volatile("" : "+v"(r[0]), "+v"(r[1]), "+v"(r[2]), "+v"(r[3]));
+  }
+  for (int j = 1; j < 10; ++j) r[0] = _mm512_add_pd(r[0], r[j]);
+  alignas(64) double lanes[8];
+  _mm512_store_pd(lanes, r[0]);
+  return static_cast<std::uint64_t>(lanes[0]);
+}
+
+#elif defined(__aarch64__)
+
+/**
+ * @brief Independent fused multiply-add chains on 128-bit NEON registers
+ */
+inline std::uint64_t neon(kernel_context&, std::size_t items) {
+  auto m = vdupq_n_f64(0.999999), k = vdupq_n_f64(1e-7);
+  float64x2_t r[10];
+  for (auto& v : r) v = vdupq_n_f64(1.0);
+  for (std::size_t i = 0; i < items; ++i) {
+    for (auto& v : r) v = vfmaq_f64(k, v, m);
+    asm volatile("" : "+w"(r[0]), "+w"(r[1]), "+w"(r[2]), "+w"(r[3]));
+  }
+  for (int j = 1; j < 10; ++j) r[0] = vaddq_f64(r[0], r[j]);
+  return static_cast<std::uint64_t>(vgetq_lane_f64(r[0], 0));
+}
+
+#endif
+
+}  // namespace kernels
+
+/**
+ * @brief Checks if a kernel is supported by the running CPU
+ */
+inline bool is_kernel_supported(const std::string& name) {
+  if (name == "scalar" || name == "stream") return true;
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (name == "sse") return __builtin_cpu_supports("sse2");
+  if (name == "avx2")
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  if (name == "avx512") return __builtin_cpu_supports("avx512f");
+#elif defined(__aarch64__)
+  if (name == "neon") return true;
+#endif
+  return false;
+}
+
+/**
+ * @brief Gets the name of the widest supported vector kernel
+ */
+inline std::string best_kernel() {
+  for (auto name : {"avx512", "avx2", "sse", "neon"})
+    if (is_kernel_supported(name)) return name;
+  return "scalar";
+}
+
+/**
+ * @brief Selects a kernel by name
+ *
+ * @param  name The kernel name, or "auto" for the widest vector kernel
+ * @return The kernel function
+ */
+inline load_kernel select_kernel(const std::string& name) {
+  if (name == "auto") return select_kernel(best_kernel());
+  if (!is_kernel_supported(name))
+    throw std::logic_error("load kernel not supported on this CPU: " + name);
+
+  if (name == "scalar") return &kernels::scalar;
+  if (name == "stream") return &kernels::stream;
+#if defined(__x86_64__) || defined(__i386__)
+  if (name == "sse") return &kernels::sse;
+  if (name == "avx2") return &kernels::avx2;
+  if (name == "avx512") return &kernels::avx512;
+#elif defined(__aarch64__)
+  if (name == "neon") return &kernels::neon;
+#endif
+  throw std::logic_error("unknown load kernel: " + name);
+}
+
+}  // namespace exot::apps::utilities
@@ -0,0 +1,124 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/memory_streams.h
+ * @author     Bruno Klopott
+ * @brief      Streaming memory kernels with non-temporal stores.
+ *
+ * Non-temporal stores bypass the caches, such that written data goes to
+ * DRAM without first being read for ownership and without evicting other
+ * lines. Buffers must be 64-byte aligned and sizes multiples of 64 bytes.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#endif
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief Reads a buffer sequentially
+ * @return A value depending on all read data
+ */
+inline std::uint64_t stream_read(const std::uint8_t* data, std::size_t size) {
+  const auto* words = reinterpret_cast<const std::uint64_t*>(data);
+  std::uint64_t a = 0, b = 0, c = 0, d = 0;
+  for (std::size_t i = 0; i < size / 8; i += 8) {
+    a += words[i] ^ words[i + 4];
+    b += words[i + 1] ^ words[i + 5];
+    c += words[i + 2] ^ words[i + 6];
+    d += words[i + 3] ^ words[i + 7];
+  }
+  return a ^ b ^ c ^ d;
+}
+
+/**
+ * @brief Writes a buffer sequentially with non-temporal stores
+ */
+inline void stream_write(std::uint8_t* data, std::size_t size,
+                         std::uint64_t value) {
+#if defined(__x86_64__) || defined(__i386__)
+  auto fill = _mm_set1_epi64x(static_cast<long long>(value));
+  for (std::size_t i = 0; i < size; i += 64) {
+    auto* line = reinterpret_cast<__m128i*>(data + i);
+    _mm_stream_si128(line, fill);
+    _mm_stream_si128(line + 1, fill);
+    _mm_stream_si128(line + 2, fill);
+    _mm_stream_si128(line + 3, fill);
+  }
+  _mm_sfence();
+#elif defined(__aarch64__)
+  for (std::size_t i = 0; i < size; i += 16)
+    asm volatile("stnp %1, %1, [%0]" : : "r"(data + i), "r"(value) : "memory");
+  asm volatile("dmb ishst" : : : "memory");
+#else
+  auto* words = reinterpret_cast<std::uint64_t*>(data);
+  for (std::size_t i = 0; i < size / 8; ++i) words[i] = value;
+#endif
+}
+
+/**
+ * @brief Copies a buffer with regular loads and non-temporal stores
+ */
+inline void stream_copy(std::uint8_t* destination, const std::uint8_t* source,
+                        std::size_t size) {
+#if defined(__x86_64__) || defined(__i386__)
+  for (std::size_t i = 0; i < size; i += 64) {
+    auto* in  = reinterpret_cast<const __m128i*>(source + i);
+    auto* out = reinterpret_cast<__m128i*>(destination + i);
+    auto v0 = _mm_load_si128(in), v1 = _mm_load_si128(in + 1);
+    auto v2 = _mm_load_si128(in + 2), v3 = _mm_load_si128(in + 3);
+    _mm_stream_si128(out, v0);
+    _mm_stream_si128(out + 1, v1);
+    _mm_stream_si128(out + 2, v2);
+    _mm_stream_si128(out + 3, v3);
+  }
+  _mm_sfence();
+#elif defined(__aarch64__)
+  for (std::size_t i = 0; i < size; i += 16) {
+    std::uint64_t low, high;
+    asm volatile("ldp %0, %1, [%2]" : "=r"(low), "=r"(high) : "r"(source + i));
+    asm volatile("stnp %1, %2, [%0]"
+                 :
+                 : "r"(destination + i), "r"(low), "r"(high)
+                 : "memory");
+  }
+  asm volatile("dmb ishst" : : : "memory");
+#else
+  std::memcpy(destination, source, size);
+#endif
+}
+
+}  // namespace exot::apps::utilities
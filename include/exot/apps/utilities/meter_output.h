@@ -0,0 +1,453 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/meter_output.h
+ * @author     Bruno Klopott
+ * @brief      Output sinks used by the binary meter host.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <exot/utilities/thread.h>
+
+#if defined(EXOT_APPS_HAVE_LZ4)
+#include <lz4.h>
+#endif
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief Writes all bytes to a file descriptor, retrying on partial writes
+ */
+inline void write_fully(int fd, const char* data, std::size_t size) {
+  while (size != 0) {
+    auto written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error(std::string{"write failed: "} +
+                               std::strerror(errno));
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+}
+
+/**
+ * @brief Opens a file for writing, truncating it if it exists
+ */
+inline int open_for_writing(const std::string& filename, int flags = 0) {
+  auto fd = ::open(filename.c_str(),
+                   O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | flags, 0644);
+  if (fd < 0)
+    throw std::runtime_error("failed to open " + filename + ": " +
+                             std::strerror(errno));
+  return fd;
+}
+
+/**
+ * @brief The interface of sinks accepting serialised records
+ */
+class output_sink {
+ public:
+  virtual ~output_sink() = default;
+
+  /**
+   * @brief Appends a chunk of data to the output
+   * @return False if the chunk was dropped, true otherwise
+   */
+  virtual bool append(const char* data, std::size_t size) = 0;
+
+  /**
+   * @brief Makes sure that all appended data reaches the output
+   */
+  virtual void flush() = 0;
+};
+
+/**
+ * @brief Appends data to a file through a preallocated buffer
+ * @details The buffer is only written out when full or when explicitly
+ *          flushed, no allocations happen after construction. Optionally,
+ *          each written-out buffer is compressed into an LZ4 block, preceded
+ *          by its decoded and encoded sizes.
+ */
+class buffered_file_writer : public output_sink {
+ public:
+  /**
+   * @param filename  The output file, truncated if it exists
+   * @param capacity  The size of the internal buffer in bytes
+   * @param compress  Compress written-out buffers with LZ4?
+   */
+  buffered_file_writer(const std::string& filename, std::size_t capacity,
+                       bool compress = false)
+      : buffer_(capacity), compress_{compress} {
+    if (capacity == 0)
+      throw std::logic_error("output buffer capacity must be non-zero");
+
+    if (compress_) {
+#if defined(EXOT_APPS_HAVE_LZ4)
+      if (capacity > static_cast<std::size_t>(LZ4_MAX_INPUT_SIZE))
+        throw std::logic_error("output buffer too large for LZ4");
+      compressed_.resize(sizeof(std::uint32_t) * 2 +
+                         LZ4_compressBound(static_cast<int>(capacity)));
+#else
+      throw std::logic_error("LZ4 compression is not available");
+#endif
+    }
+
+    fd_ = open_for_writing(filename);
+  }
+
+  ~buffered_file_writer() override {
+    try {
+      flush();
+    } catch (...) {}
+    ::close(fd_);
+  }
+
+  buffered_file_writer(const buffered_file_writer&) = delete;
+  buffered_file_writer& operator=(const buffered_file_writer&) = delete;
+
+  /**
+   * @brief Appends a chunk of data of arbitrary size
+   */
+  bool append(const char* data, std::size_t size) override {
+    while (size != 0) {
+      if (used_ == buffer_.size()) flush();
+
+      auto chunk = std::min(size, buffer_.size() - used_);
+      std::memcpy(buffer_.data() + used_, data, chunk);
+      used_ += chunk;
+      data += chunk;
+      size -= chunk;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Writes the header straight to the file, bypassing compression
+   * @note  Must be called before any other data is appended.
+   */
+  void write_header(const char* data, std::size_t size) {
+    if (used_ != 0)
+      throw std::logic_error("header must precede all other data");
+    write_fully(fd_, data, size);
+  }
+
+  /**
+   * @brief Writes the buffered data to the file
+   */
+  void flush() override {
+    if (used_ == 0) return;
+
+#if defined(EXOT_APPS_HAVE_LZ4)
+    if (compress_) {
+      auto* sizes = compressed_.data();
+      auto* block = sizes + sizeof(std::uint32_t) * 2;
+      auto encoded =
+          LZ4_compress_default(buffer_.data(), block, static_cast<int>(used_),
+                               static_cast<int>(compressed_.size() -
+                                                sizeof(std::uint32_t) * 2));
+      if (encoded <= 0) throw std::runtime_error("LZ4 compression failed");
+
+      auto decoded_size = static_cast<std::uint32_t>(used_);
+      auto encoded_size = static_cast<std::uint32_t>(encoded);
+      std::memcpy(sizes, &decoded_size, sizeof(decoded_size));
+      std::memcpy(sizes + sizeof(decoded_size), &encoded_size,
+                  sizeof(encoded_size));
+
+      write_fully(fd_, compressed_.data(),
+                  sizeof(std::uint32_t) * 2 + encoded_size);
+      used_ = 0;
+      return;
+    }
+#endif
+
+    write_fully(fd_, buffer_.data(), used_);
+    used_ = 0;
+  }
+
+ private:
+  std::vector<char> buffer_;
+  std::vector<char> compressed_;
+  std::size_t used_{0};
+  bool compress_{false};
+  int fd_{-1};
+};
+
+/**
+ * @brief Appends data to a file through a memory-mapped ring buffer
+ * @details The ring buffer lives in a memory-mapped file in a directory
+ *          which should be on tmpfs, e.g. /dev/shm, such that the kernel
+ *          never writes back its pages. The file is named after the output
+ *          and the process ("<output name>.<pid>.ring"), left behind if the
+ *          process dies for inspection, and removed after a clean shutdown.
+ *          Without a directory, the ring is anonymous memory. A single
+ *          producer copies data into the ring without locks or system
+ *          calls. A background drainer thread, optionally pinned to a
+ *          separate core, writes the ring's contents to the output file.
+ *
+ *          If the ring has insufficient space, the chunk is dropped and
+ *          counted as an overrun; the producer never waits for the drainer.
+ */
+class mmap_ring_writer : public output_sink {
+ public:
+  /**
+   * @brief Statistics of the ring buffer, reported at shutdown
+   */
+  struct statistics {
+    std::uint64_t appended_chunks;
+    std::uint64_t overrun_chunks;
+    std::uint64_t overrun_bytes;
+    std::uint64_t drained_bytes;
+    std::uint64_t max_occupancy;
+    bool drainer_failed;
+  };
+
+  /**
+   * @param filename        The output file, truncated if it exists
+   * @param capacity        The size of the ring in bytes, rounded up to a
+   *                        power of two
+   * @param ring_directory  The directory of the ring file, anonymous memory
+   *                        if empty
+   * @param drainer_pinning The core to pin the drainer thread to
+   * @param drain_interval  The interval at which an empty ring is polled
+   */
+  mmap_ring_writer(const std::string& filename, std::size_t capacity,
+                   const std::string& ring_directory = "/dev/shm",
+                   std::optional<unsigned> drainer_pinning = std::nullopt,
+                   std::chrono::microseconds drain_interval =
+                       std::chrono::microseconds{1000})
+      : drain_interval_{drain_interval} {
+    if (capacity == 0)
+      throw std::logic_error("ring buffer capacity must be non-zero");
+
+    capacity_ = 1;
+    while (capacity_ < capacity) capacity_ <<= 1;
+    mask_ = capacity_ - 1;
+    mapping_size_ = sizeof(control_block) + capacity_;
+
+    out_fd_ = open_for_writing(filename);
+
+    void* mapping = MAP_FAILED;
+    if (ring_directory.empty()) {
+      mapping = ::mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    } else {
+      auto name = filename.substr(filename.find_last_of('/') + 1);
+      ring_filename_ =
+          ring_directory + "/" + name + "." + std::to_string(::getpid()) +
+          ".ring";
+      mapping = map_ring_file();
+    }
+
+    if (mapping == MAP_FAILED) {
+      auto error = errno;
+      ::close(out_fd_);
+      if (!ring_filename_.empty()) ::unlink(ring_filename_.c_str());
+      throw std::runtime_error(
+          "failed to map the ring buffer" +
+          (ring_filename_.empty() ? "" : " " + ring_filename_) + ": " +
+          std::strerror(error));
+    }
+
+    control_ = new (mapping) control_block{};
+    data_    = static_cast<char*>(mapping) + sizeof(control_block);
+
+    drainer_ = std::thread([this, drainer_pinning] {
+      if (drainer_pinning.has_value())
+        exot::utilities::ThreadTraits::set_affinity(drainer_pinning.value());
+      drain_loop();
+    });
+  }
+
+  ~mmap_ring_writer() override {
+    stop();
+    ::munmap(static_cast<void*>(control_), mapping_size_);
+    if (!ring_filename_.empty()) ::unlink(ring_filename_.c_str());
+    ::close(out_fd_);
+  }
+
+  mmap_ring_writer(const mmap_ring_writer&) = delete;
+  mmap_ring_writer& operator=(const mmap_ring_writer&) = delete;
+
+  /**
+   * @brief Copies a chunk into the ring, or drops it if there is no space
+   * @note  Must only be called from a single producer thread.
+   */
+  bool append(const char* data, std::size_t size) override {
+    auto head = control_->head.load(std::memory_order_relaxed);
+    auto tail = control_->tail.load(std::memory_order_acquire);
+    auto used = head - tail;
+
+    if (size > capacity_ - used) {
+      ++overrun_chunks_;
+      overrun_bytes_ += size;
+      return false;
+    }
+
+    auto offset = static_cast<std::size_t>(head & mask_);
+    auto first  = std::min(size, capacity_ - offset);
+    std::memcpy(data_ + offset, data, first);
+    std::memcpy(data_, data + first, size - first);
+
+    control_->head.store(head + size, std::memory_order_release);
+
+    ++appended_chunks_;
+    if (used + size > max_occupancy_) max_occupancy_ = used + size;
+    return true;
+  }
+
+  /**
+   * @brief Waits until the drainer has written out all appended data
+   * @note  Only meant to be used at shutdown, since it blocks the producer.
+   */
+  void flush() override {
+    while (control_->tail.load(std::memory_order_acquire) !=
+               control_->head.load(std::memory_order_relaxed) &&
+           !drainer_failed_.load(std::memory_order_acquire)) {
+      std::this_thread::sleep_for(drain_interval_);
+    }
+  }
+
+  /**
+   * @brief Drains the remaining data and stops the drainer thread
+   */
+  void stop() {
+    if (!drainer_.joinable()) return;
+    stopping_.store(true, std::memory_order_release);
+    drainer_.join();
+  }
+
+  statistics get_statistics() const {
+    return {appended_chunks_, overrun_chunks_, overrun_bytes_,
+            drained_bytes_.load(std::memory_order_acquire), max_occupancy_,
+            drainer_failed_.load(std::memory_order_acquire)};
+  }
+
+ private:
+  /**
+   * @brief The control block at the beginning of the mapped file
+   * @details Head and tail are monotonic byte offsets, placed on separate
+   *          cache lines to avoid false sharing between the two threads.
+   */
+  struct control_block {
+    alignas(64) std::atomic<std::uint64_t> head{0};
+    alignas(64) std::atomic<std::uint64_t> tail{0};
+  };
+
+  /**
+   * @brief Creates the ring file and maps it
+   * @return The mapping, or MAP_FAILED with errno set
+   */
+  void* map_ring_file() {
+    auto fd = ::open(ring_filename_.c_str(),
+                     O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return MAP_FAILED;
+
+    void* mapping = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(mapping_size_)) == 0)
+      mapping = ::mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, 0);
+
+    auto error = errno;
+    ::close(fd);
+    errno = error;
+    return mapping;
+  }
+
+  void drain_loop() {
+    while (true) {
+      auto stopping = stopping_.load(std::memory_order_acquire);
+      auto tail     = control_->tail.load(std::memory_order_relaxed);
+      auto head     = control_->head.load(std::memory_order_acquire);
+
+      if (head == tail) {
+        if (stopping) return;
+        std::this_thread::sleep_for(drain_interval_);
+        continue;
+      }
+
+      auto size   = static_cast<std::size_t>(head - tail);
+      auto offset = static_cast<std::size_t>(tail & mask_);
+      auto first  = std::min(size, capacity_ - offset);
+
+      try {
+        write_fully(out_fd_, data_ + offset, first);
+        write_fully(out_fd_, data_, size - first);
+      } catch (...) {
+        drainer_failed_.store(true, std::memory_order_release);
+        return;
+      }
+
+      control_->tail.store(head, std::memory_order_release);
+      drained_bytes_.fetch_add(size, std::memory_order_release);
+    }
+  }
+
+  std::string ring_filename_;
+  std::chrono::microseconds drain_interval_;
+  std::size_t capacity_{0};
+  std::size_t mask_{0};
+  std::size_t mapping_size_{0};
+  int out_fd_{-1};
+
+  control_block* control_{nullptr};
+  char* data_{nullptr};
+
+  std::thread drainer_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<bool> drainer_failed_{false};
+  std::atomic<std::uint64_t> drained_bytes_{0};
+
+  /* Producer-side counters, only accessed from the producer thread. */
+  std::uint64_t appended_chunks_{0};
+  std::uint64_t overrun_chunks_{0};
+  std::uint64_t overrun_bytes_{0};
+  std::uint64_t max_occupancy_{0};
+};
+
+}  // namespace exot::apps::utilities
@@ -0,0 +1,225 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/msr_batch.h
+ * @author     Bruno Klopott
+ * @brief      Batched reads of model-specific registers across CPUs.
+ *
+ * A batch is a fixed list of (CPU, register) pairs, read together on every
+ * sample. With the "msr" backend, every CPU's /dev/cpu/N/msr device is
+ * opened once and each register costs one pread. With the "msr_batch"
+ * backend, available with the msr-safe kernel module, all registers are
+ * read with a single ioctl on /dev/cpu/msr_batch, such that a sample costs
+ * one system call regardless of the number of CPUs. The "auto" backend
+ * uses the batch device if it can be opened.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace exot::apps::utilities {
+
+enum class msr_backend { automatic, msr, msr_batch };
+
+inline msr_backend parse_msr_backend(const std::string& name) {
+  if (name == "auto") return msr_backend::automatic;
+  if (name == "msr") return msr_backend::msr;
+  if (name == "msr_batch") return msr_backend::msr_batch;
+  throw std::logic_error("unknown MSR backend: " + name);
+}
+
+inline const char* to_string(msr_backend backend) {
+  switch (backend) {
+    case msr_backend::msr:
+      return "msr";
+    case msr_backend::msr_batch:
+      return "msr_batch";
+    default:
+      return "auto";
+  }
+}
+
+namespace details {
+
+/* The batch interface of the msr-safe module, see msr_batch.h therein. */
+struct msr_batch_op {
+  std::uint16_t cpu;
+  std::uint16_t isrdmsr;
+  std::int32_t err;
+  std::uint32_t msr;
+  std::uint64_t msrdata;
+  std::uint64_t wmask;
+};
+
+struct msr_batch_array {
+  std::uint32_t numops;
+  msr_batch_op* ops;
+};
+
+inline constexpr unsigned long msr_batch_request =
+    _IOWR('c', 0xA2, msr_batch_array);
+
+/**
+ * @brief Opens the register device of a CPU, preferring msr-safe's
+ */
+inline int open_msr_device(unsigned cpu) {
+  auto fd = ::open(fmt::format("/dev/cpu/{}/msr_safe", cpu).c_str(),
+                   O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    fd = ::open(fmt::format("/dev/cpu/{}/msr", cpu).c_str(),
+                O_RDONLY | O_CLOEXEC);
+  return fd;
+}
+
+}  // namespace details
+
+/**
+ * @brief Reads a single register once, e.g. a unit or limit register
+ * @return The value, or nullopt if the device or register is unavailable
+ */
+inline std::optional<std::uint64_t> read_msr(unsigned cpu,
+                                             std::uint32_t reg) {
+  auto fd = details::open_msr_device(cpu);
+  if (fd < 0) return std::nullopt;
+
+  std::uint64_t value;
+  auto length = ::pread(fd, &value, sizeof(value), reg);
+  ::close(fd);
+
+  if (length != sizeof(value)) return std::nullopt;
+  return value;
+}
+
+/**
+ * @brief A fixed set of registers read together
+ */
+class msr_batch {
+ public:
+  explicit msr_batch(msr_backend backend = msr_backend::automatic) {
+    if (backend != msr_backend::msr) {
+      batch_fd_ = ::open("/dev/cpu/msr_batch", O_RDONLY | O_CLOEXEC);
+      if (batch_fd_ < 0 && backend == msr_backend::msr_batch)
+        throw std::runtime_error(
+            fmt::format("failed to open /dev/cpu/msr_batch: {}",
+                        std::strerror(errno)));
+    }
+  }
+
+  ~msr_batch() {
+    if (batch_fd_ >= 0) ::close(batch_fd_);
+    for (auto& [cpu, fd] : fds_) ::close(fd);
+  }
+
+  msr_batch(const msr_batch&) = delete;
+  msr_batch& operator=(const msr_batch&) = delete;
+
+  /**
+   * @brief Adds a register to the batch
+   * @return The slot of the register's value
+   */
+  std::size_t add(unsigned cpu, std::uint32_t reg) {
+    if (batch_fd_ < 0 && fds_.find(cpu) == fds_.end()) {
+      auto fd = details::open_msr_device(cpu);
+      if (fd < 0)
+        throw std::runtime_error(
+            fmt::format("failed to open the MSR device of cpu {}: {}", cpu,
+                        std::strerror(errno)));
+      fds_.emplace(cpu, fd);
+    }
+
+    details::msr_batch_op op{};
+    op.cpu     = static_cast<std::uint16_t>(cpu);
+    op.isrdmsr = 1;
+    op.msr     = reg;
+    ops_.push_back(op);
+    devices_.push_back(batch_fd_ < 0 ? fds_.at(cpu) : -1);
+    return ops_.size() - 1;
+  }
+
+  /**
+   * @brief Reads all registers
+   * @return False if any register could not be read, see ok()
+   */
+  bool read() {
+    auto success = true;
+
+    if (batch_fd_ >= 0) {
+      for (auto& op : ops_) op.err = 0;
+      details::msr_batch_array array{static_cast<std::uint32_t>(ops_.size()),
+                                     ops_.data()};
+      if (::ioctl(batch_fd_, details::msr_batch_request, &array) < 0) {
+        for (auto& op : ops_) op.err = -errno;
+        return false;
+      }
+      for (const auto& op : ops_) success = success && op.err == 0;
+      return success;
+    }
+
+    for (std::size_t i = 0; i < ops_.size(); ++i) {
+      auto& op = ops_[i];
+      auto ok  = ::pread(devices_[i], &op.msrdata, sizeof(op.msrdata),
+                        op.msr) == sizeof(op.msrdata);
+      op.err   = ok ? 0 : -EIO;
+      success  = success && ok;
+    }
+
+    return success;
+  }
+
+  std::uint64_t value(std::size_t slot) const { return ops_[slot].msrdata; }
+  bool ok(std::size_t slot) const { return ops_[slot].err == 0; }
+  std::size_t size() const { return ops_.size(); }
+
+  /* @brief The backend in use, "msr" or "msr_batch" */
+  msr_backend backend() const {
+    return batch_fd_ >= 0 ? msr_backend::msr_batch : msr_backend::msr;
+  }
+
+ private:
+  int batch_fd_{-1};
+  std::unordered_map<unsigned, int> fds_;  //! per-CPU devices, by CPU
+  std::vector<details::msr_batch_op> ops_;
+  std::vector<int> devices_;  //! per-register devices for the pread path
+};
+
+}  // namespace exot::apps::utilities
@@ -0,0 +1,141 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/node_memory.h
+ * @author     Bruno Klopott
+ * @brief      Node-local, hugepage-backed memory buffers.
+ */
+
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <exot/apps/utilities/sysfs_reader.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief Gets the NUMA node of a core, or 0 on non-NUMA systems
+ */
+inline unsigned node_of(unsigned core) {
+  auto nodes = list_numbered_entries(
+      fmt::format("/sys/devices/system/cpu/cpu{}", core), "node");
+  return nodes.empty() ? 0u : nodes.front();
+}
+
+/**
+ * @brief An anonymous memory buffer bound to a NUMA node
+ * @details The buffer is first requested from the hugetlb pool with pages
+ *          of the given size. If the pool cannot provide it, regular pages
+ *          are mapped and transparent hugepages are requested instead. The
+ *          mapping is bound to the node with mbind and touched, such that
+ *          it is populated when the constructor returns.
+ */
+class node_buffer {
+ public:
+  /**
+   * @param size      The minimum size in bytes, rounded up to the page size
+   * @param node      The NUMA node, or a negative value for no binding
+   * @param hugepages Use hugepages?
+   * @param page_size The hugepage size, e.g. 2 MiB or 1 GiB
+   */
+  node_buffer(std::size_t size, int node, bool hugepages = true,
+              std::size_t page_size = std::size_t{2} << 20) {
+    if (hugepages) {
+      size_ = (size + page_size - 1) / page_size * page_size;
+      auto log2 = 0;
+      while ((std::size_t{1} << log2) < page_size) ++log2;
+
+      data_ = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                         (log2 << MAP_HUGE_SHIFT),
+                     -1, 0);
+      huge_ = data_ != MAP_FAILED;
+    }
+
+    if (!huge_) {
+      size_ = (size + 4095) / 4096 * 4096;
+      data_ = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (data_ == MAP_FAILED)
+        throw std::runtime_error(
+            fmt::format("failed to map {} bytes: {}", size_,
+                        std::strerror(errno)));
+#if defined(MADV_HUGEPAGE)
+      if (hugepages) ::madvise(data_, size_, MADV_HUGEPAGE);
+#endif
+    }
+
+    if (node >= 0 && node < 64) {
+      // MPOL_BIND and MPOL_MF_MOVE, without depending on libnuma
+      constexpr int mpol_bind         = 2;
+      constexpr unsigned mpol_mf_move = 1u << 1;
+      auto mask = std::uint64_t{1} << node;
+      bound_ = ::syscall(SYS_mbind, data_, size_, mpol_bind, &mask, 64,
+                         mpol_mf_move) == 0;
+    }
+
+    std::memset(data_, 0, size_);
+  }
+
+  ~node_buffer() {
+    if (data_ != MAP_FAILED && data_ != nullptr) ::munmap(data_, size_);
+  }
+
+  node_buffer(const node_buffer&) = delete;
+  node_buffer& operator=(const node_buffer&) = delete;
+
+  std::uint8_t* data() const { return static_cast<std::uint8_t*>(data_); }
+  std::size_t size() const { return size_; }
+  bool is_huge() const { return huge_; }  //! backed by the hugetlb pool?
+  bool is_bound() const { return bound_; }
+
+ private:
+  void* data_{nullptr};
+  std::size_t size_{0};
+  bool huge_{false};
+  bool bound_{false};
+};
+
+}  // namespace exot::apps::utilities
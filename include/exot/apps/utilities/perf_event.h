@@ -0,0 +1,406 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/perf_event.h
+ * @author     Bruno Klopott
+ * @brief      Opening performance counters with perf_event_open, including
+ *             events of dynamic PMUs described in sysfs, and reading them
+ *             in user space with rdpmc.
+ */
+
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <exot/apps/utilities/sysfs_reader.h>
+
+namespace exot::apps::utilities {
+
+inline constexpr const char* pmu_directory = "/sys/bus/event_source/devices";
+
+/**
+ * @brief Calls perf_event_open
+ * @return The file descriptor, or -1 with errno set
+ */
+inline int perf_event_open(::perf_event_attr& attr, pid_t pid, int cpu,
+                           int group_fd, unsigned long flags = 0) {
+  return static_cast<int>(
+      ::syscall(SYS_perf_event_open, &attr, pid, cpu, group_fd, flags));
+}
+
+/**
+ * @brief A perf event file descriptor
+ */
+class perf_counter {
+ public:
+  perf_counter() = default;
+  explicit perf_counter(int fd) : fd_{fd} {}
+  ~perf_counter() {
+    if (fd_ >= 0) ::close(fd_);
+  }
+
+  perf_counter(perf_counter&& other) noexcept
+      : fd_{std::exchange(other.fd_, -1)} {}
+  perf_counter& operator=(perf_counter&& other) noexcept {
+    std::swap(fd_, other.fd_);
+    return *this;
+  }
+
+  perf_counter(const perf_counter&) = delete;
+  perf_counter& operator=(const perf_counter&) = delete;
+
+  /**
+   * @brief Reads the counter value
+   * @return The value, or nullopt if the read failed
+   */
+  std::optional<std::uint64_t> read() const {
+    std::uint64_t value;
+    if (::read(fd_, &value, sizeof(value)) != sizeof(value))
+      return std::nullopt;
+    return value;
+  }
+
+  int fd() const { return fd_; }
+  bool is_open() const { return fd_ >= 0; }
+
+ private:
+  int fd_{-1};
+};
+
+namespace details {
+
+inline std::optional<std::string> read_line(const std::string& path) {
+  std::ifstream file{path};
+  std::string line;
+  if (!std::getline(file, line)) return std::nullopt;
+  return line;
+}
+
+/**
+ * @brief Places a value into the bit range given by a PMU format
+ * @details Formats look like "config:0-7" or "config1:0-15,32-47"; only
+ *          single ranges of "config" are supported, which suffices for the
+ *          events used by the apps.
+ */
+inline bool apply_format(const std::string& format, std::uint64_t value,
+                         std::uint64_t& config) {
+  auto colon = format.find(':');
+  if (colon == std::string::npos || format.substr(0, colon) != "config")
+    return false;
+
+  auto range = format.substr(colon + 1);
+  if (range.find(',') != std::string::npos) return false;
+
+  auto dash = range.find('-');
+  auto low  = std::stoul(range.substr(0, dash));
+  auto high =
+      dash == std::string::npos ? low : std::stoul(range.substr(dash + 1));
+  auto width = high - low + 1;
+  auto mask =
+      width >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << width) - 1;
+
+  config |= (value & mask) << low;
+  return true;
+}
+
+}  // namespace details
+
+/**
+ * @brief An event of a dynamic PMU, as described in sysfs
+ */
+struct pmu_event {
+  std::uint32_t type;      //! the PMU type for perf_event_attr
+  std::uint64_t config;    //! the encoded event
+  double scale;            //! the scale to apply to counts, 1 if not given
+  std::vector<int> cpus;   //! the CPUs to open the event on, empty if any
+};
+
+/**
+ * @brief Resolves a named event of a PMU from sysfs
+ * @details For example, ("uncore_imc_0", "cas_count_read") reads the PMU
+ *          type, the event encoding such as "event=0x04,umask=0x03", the
+ *          field formats, the scale, and the PMU's CPU mask.
+ *
+ * @return The event, or nullopt if the PMU or the event does not exist
+ */
+inline std::optional<pmu_event> resolve_pmu_event(const std::string& pmu,
+                                                  const std::string& event) {
+  auto base = fmt::format("{}/{}", pmu_directory, pmu);
+
+  auto type = details::read_line(base + "/type");
+  auto spec = details::read_line(fmt::format("{}/events/{}", base, event));
+  if (!type || !spec) return std::nullopt;
+
+  pmu_event result{static_cast<std::uint32_t>(std::stoul(*type)), 0, 1.0, {}};
+
+  std::istringstream terms{*spec};
+  std::string term;
+  while (std::getline(terms, term, ',')) {
+    auto equals = term.find('=');
+    auto name   = term.substr(0, equals);
+    auto value  = equals == std::string::npos
+                     ? std::uint64_t{1}
+                     : std::stoull(term.substr(equals + 1), nullptr, 0);
+
+    auto format = details::read_line(fmt::format("{}/format/{}", base, name));
+    if (!format || !details::apply_format(*format, value, result.config))
+      return std::nullopt;
+  }
+
+  if (auto scale = details::read_line(
+          fmt::format("{}/events/{}.scale", base, event)))
+    result.scale = std::stod(*scale);
+
+  if (auto cpumask = details::read_line(base + "/cpumask")) {
+    std::istringstream list{*cpumask};
+    std::string item;
+    while (std::getline(list, item, ',')) {
+      auto dash = item.find('-');
+      auto low  = std::stoi(item.substr(0, dash));
+      auto high =
+          dash == std::string::npos ? low : std::stoi(item.substr(dash + 1));
+      for (auto cpu = low; cpu <= high; ++cpu) result.cpus.push_back(cpu);
+    }
+  }
+
+  return result;
+}
+
+/**
+ * @brief Lists PMUs whose names start with a prefix, e.g. "uncore_imc"
+ */
+inline std::vector<std::string> list_pmus(const std::string& prefix) {
+  std::vector<std::string> names;
+  for (auto number : list_numbered_entries(pmu_directory, prefix + "_"))
+    names.push_back(fmt::format("{}_{}", prefix, number));
+  return names;
+}
+
+/**
+ * @brief The type and configuration of a perf event
+ */
+struct perf_event_spec {
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+/**
+ * @brief Parses an event name
+ * @details Accepts generic hardware events ("cycles", "instructions",
+ *          "cache-references", "cache-misses", "branches", "branch-misses",
+ *          "ref-cycles"), software events ("cpu-clock", "context-switches",
+ *          "cpu-migrations", "page-faults"), last-level and first-level
+ *          data cache events ("llc-loads", "llc-load-misses", "llc-stores",
+ *          "llc-store-misses", "l1d-loads", "l1d-load-misses"), raw events
+ *          ("raw:0x1c0"), and events of PMUs described in sysfs
+ *          ("cpu/mem-loads", "uncore_imc_0/cas_count_read").
+ *
+ * @return The event, or nullopt if the name is unknown
+ */
+inline std::optional<perf_event_spec> parse_perf_event(
+    const std::string& name) {
+  static const std::pair<const char*, std::uint64_t> hardware[] = {
+      {"cycles", PERF_COUNT_HW_CPU_CYCLES},
+      {"instructions", PERF_COUNT_HW_INSTRUCTIONS},
+      {"cache-references", PERF_COUNT_HW_CACHE_REFERENCES},
+      {"cache-misses", PERF_COUNT_HW_CACHE_MISSES},
+      {"branches", PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+      {"branch-misses", PERF_COUNT_HW_BRANCH_MISSES},
+      {"ref-cycles", PERF_COUNT_HW_REF_CPU_CYCLES}};
+
+  static const std::pair<const char*, std::uint64_t> software[] = {
+      {"cpu-clock", PERF_COUNT_SW_CPU_CLOCK},
+      {"context-switches", PERF_COUNT_SW_CONTEXT_SWITCHES},
+      {"cpu-migrations", PERF_COUNT_SW_CPU_MIGRATIONS},
+      {"page-faults", PERF_COUNT_SW_PAGE_FAULTS}};
+
+  constexpr auto cache = [](std::uint64_t id, std::uint64_t op,
+                            std::uint64_t result) {
+    return id | (op << 8) | (result << 16);
+  };
+
+  const std::pair<const char*, std::uint64_t> caches[] = {
+      {"llc-loads", cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                          PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+      {"llc-load-misses",
+       cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+             PERF_COUNT_HW_CACHE_RESULT_MISS)},
+      {"llc-stores", cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_WRITE,
+                           PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+      {"llc-store-misses",
+       cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_WRITE,
+             PERF_COUNT_HW_CACHE_RESULT_MISS)},
+      {"l1d-loads", cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                          PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+      {"l1d-load-misses",
+       cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+             PERF_COUNT_HW_CACHE_RESULT_MISS)}};
+
+  for (const auto& [event, config] : hardware)
+    if (name == event) return perf_event_spec{PERF_TYPE_HARDWARE, config};
+  for (const auto& [event, config] : software)
+    if (name == event) return perf_event_spec{PERF_TYPE_SOFTWARE, config};
+  for (const auto& [event, config] : caches)
+    if (name == event) return perf_event_spec{PERF_TYPE_HW_CACHE, config};
+
+  if (name.compare(0, 4, "raw:") == 0)
+    return perf_event_spec{PERF_TYPE_RAW,
+                           std::stoull(name.substr(4), nullptr, 0)};
+
+  auto slash = name.find('/');
+  if (slash != std::string::npos) {
+    auto event =
+        resolve_pmu_event(name.substr(0, slash), name.substr(slash + 1));
+    if (event) return perf_event_spec{event->type, event->config};
+  }
+
+  return std::nullopt;
+}
+
+/**
+ * @brief The user page of a perf event, for reading it with rdpmc
+ * @details The counter can be read in user space while the event is
+ *          scheduled on the calling thread's CPU, which for per-CPU events
+ *          means the reading thread runs on that CPU. Where rdpmc is not
+ *          allowed, e.g. with /sys/bus/event_source/devices/cpu/rdpmc set
+ *          to 0 or on other architectures, read() always fails and the
+ *          counter has to be read with the read system call.
+ */
+class perf_user_page {
+ public:
+  perf_user_page() = default;
+  explicit perf_user_page(int fd) {
+    auto* page = ::mmap(nullptr, static_cast<std::size_t>(::getpagesize()),
+                        PROT_READ, MAP_SHARED, fd, 0);
+    if (page != MAP_FAILED) page_ = static_cast<::perf_event_mmap_page*>(page);
+  }
+
+  ~perf_user_page() {
+    if (page_ != nullptr)
+      ::munmap(page_, static_cast<std::size_t>(::getpagesize()));
+  }
+
+  perf_user_page(perf_user_page&& other) noexcept
+      : page_{std::exchange(other.page_, nullptr)} {}
+  perf_user_page& operator=(perf_user_page&& other) noexcept {
+    std::swap(page_, other.page_);
+    return *this;
+  }
+
+  perf_user_page(const perf_user_page&) = delete;
+  perf_user_page& operator=(const perf_user_page&) = delete;
+
+  bool is_mapped() const { return page_ != nullptr; }
+
+  /**
+   * @brief Reads the count and the enabled and running times
+   * @details Follows the sequence documented in linux/perf_event.h,
+   *          extrapolating the times with the TSC while multiplexed.
+   *
+   * @return False if the counter cannot be read in user space now
+   */
+  bool read(std::uint64_t& count, std::uint64_t& enabled,
+            std::uint64_t& running) const {
+#if defined(__x86_64__)
+    if (page_ == nullptr) return false;
+
+    std::uint32_t sequence, index;
+    do {
+      sequence = page_->lock;
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+
+      enabled = page_->time_enabled;
+      running = page_->time_running;
+      if (page_->cap_user_time && enabled != running) {
+        auto cycles = rdtsc();
+        auto shift  = page_->time_shift;
+        auto mult   = std::uint64_t{page_->time_mult};
+        auto delta  = page_->time_offset + (cycles >> shift) * mult +
+                     (((cycles & ((std::uint64_t{1} << shift) - 1)) * mult) >>
+                      shift);
+        enabled += delta;
+        running += delta;
+      }
+
+      index = page_->index;
+      if (!page_->cap_user_rdpmc || index == 0) return false;
+
+      auto width = page_->pmc_width;
+      auto pmc   = static_cast<std::int64_t>(rdpmc(index - 1) << (64 - width));
+      count = static_cast<std::uint64_t>(page_->offset + (pmc >> (64 - width)));
+
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+    } while (page_->lock != sequence);
+
+    return true;
+#else
+    static_cast<void>(count);
+    static_cast<void>(enabled);
+    static_cast<void>(running);
+    return false;
+#endif
+  }
+
+ private:
+#if defined(__x86_64__)
+  static std::uint64_t rdpmc(std::uint32_t counter) {
+    std::uint32_t low, high;
+    asm volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(counter));
+    return (std::uint64_t{high} << 32) | low;
+  }
+
+  static std::uint64_t rdtsc() {
+    std::uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return (std::uint64_t{high} << 32) | low;
+  }
+#endif
+
+  ::perf_event_mmap_page* page_{nullptr};
+};
+
+}  // namespace exot::apps::utilities
@@ -0,0 +1,95 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/pi_controller.h
+ * @author     Bruno Klopott
+ * @brief      A proportional-integral controller with a saturated output.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief A PI controller with anti-windup
+ * @details The output is clamped to [min, max]. While the output is
+ *          saturated, the integral is only updated if the error drives the
+ *          output back into range (conditional integration), such that the
+ *          controller does not wind up while the actuator is at its limit.
+ */
+class pi_controller {
+ public:
+  pi_controller(double kp, double ki, double min, double max)
+      : kp_{kp}, ki_{ki}, min_{min}, max_{max} {
+    if (!(min < max))
+      throw std::logic_error("pi_controller requires min < max");
+  }
+
+  /**
+   * @brief Computes the next output
+   *
+   * @param  error The difference between the target and the measurement
+   * @param  dt    The time since the last update in seconds
+   * @return The output in [min, max]
+   */
+  double update(double error, double dt) {
+    auto integral = integral_ + error * dt;
+    auto output   = kp_ * error + ki_ * integral;
+
+    if (output > max_) {
+      output = max_;
+      if (error > 0.0) integral = integral_;
+    } else if (output < min_) {
+      output = min_;
+      if (error < 0.0) integral = integral_;
+    }
+
+    integral_ = integral;
+    return output;
+  }
+
+  /**
+   * @brief Resets the integral, such that a zero error yields an output
+   */
+  void reset(double output = 0.0) {
+    integral_ = ki_ != 0.0 ? std::clamp(output, min_, max_) / ki_ : 0.0;
+  }
+
+ private:
+  double kp_;
+  double ki_;
+  double min_;
+  double max_;
+  double integral_{0.0};
+};
+
+}  // namespace exot::apps::utilities
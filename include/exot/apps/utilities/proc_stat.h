@@ -0,0 +1,291 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/proc_stat.h
+ * @author     Bruno Klopott
+ * @brief      An allocation-free parser of the per-core times in /proc/stat.
+ *
+ * The file is kept open and read with a single pread per sample into a
+ * buffer sized at construction, which covers the per-core lines at the top
+ * of the file; the interrupt and softirq counters after them are not
+ * copied. The per-core lines are parsed in place, and the busy and total
+ * times as well as their deltas to the previous read are kept as separate
+ * arrays indexed by the core's position.
+ *
+ * The kernel does not guarantee that every field grows: iowait can go down,
+ * and so can idle under NO_HZ. Deltas are therefore taken per field and
+ * clamped at zero before they are summed.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace exot::apps::utilities {
+
+namespace details {
+
+/**
+ * @brief Finds the next newline, 16 bytes at a time where SIMD is available
+ */
+inline const char* find_newline(const char* begin, const char* end) {
+#if defined(__SSE2__)
+  const auto newline = _mm_set1_epi8('\n');
+  for (; end - begin >= 16; begin += 16) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    auto mask  = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+    if (mask != 0) return begin + __builtin_ctz(static_cast<unsigned>(mask));
+  }
+#elif defined(__aarch64__)
+  const auto newline = vdupq_n_u8('\n');
+  for (; end - begin >= 16; begin += 16) {
+    auto chunk = vld1q_u8(reinterpret_cast<const std::uint8_t*>(begin));
+    if (vmaxvq_u8(vceqq_u8(chunk, newline)) != 0) break;
+  }
+#endif
+  for (; begin != end; ++begin)
+    if (*begin == '\n') return begin;
+  return end;
+}
+
+/**
+ * @brief Parses a space-separated unsigned field
+ * @return The position after the field
+ */
+inline const char* parse_field(const char* begin, const char* end,
+                               std::uint64_t& value) {
+  while (begin != end && *begin == ' ') ++begin;
+  value = 0;
+  for (; begin != end && static_cast<unsigned>(*begin - '0') < 10u; ++begin)
+    value = value * 10 + static_cast<unsigned>(*begin - '0');
+  return begin;
+}
+
+}  // namespace details
+
+/**
+ * @brief Reads per-core busy and total times from /proc/stat, in ticks
+ * @details Busy time includes the user, nice, system, irq, softirq and
+ *          steal fields, total time additionally the idle and iowait
+ *          fields. Guest time is already accounted in the user time.
+ */
+class proc_stat {
+ public:
+  static constexpr std::size_t fields = 8;  //! user to steal
+
+  explicit proc_stat(const char* path = "/proc/stat") {
+    fd_ = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0)
+      throw std::runtime_error(std::string{"failed to open "} + path + ": " +
+                               std::strerror(errno));
+
+    discover();
+
+    times_.assign(cores_.size() * fields, 0);
+    parsed_.assign(cores_.size() * fields, 0);
+    seen_.assign(cores_.size(), false);
+    busy_.assign(cores_.size(), 0);
+    total_.assign(cores_.size(), 0);
+    busy_delta_.assign(cores_.size(), 0);
+    total_delta_.assign(cores_.size(), 0);
+
+    if (!read())
+      throw std::runtime_error(std::string{"failed to parse "} + path);
+    std::fill(busy_delta_.begin(), busy_delta_.end(), 0);
+    std::fill(total_delta_.begin(), total_delta_.end(), 0);
+  }
+
+  ~proc_stat() {
+    if (fd_ >= 0) ::close(fd_);
+  }
+
+  proc_stat(const proc_stat&) = delete;
+  proc_stat& operator=(const proc_stat&) = delete;
+
+  /**
+   * @brief Reads the file and updates the times and their deltas
+   * @details Cores absent from the file, e.g. taken offline, keep their
+   *          previous times and get zero deltas. The lines are parsed into
+   *          scratch space first, so a failed read changes nothing.
+   *
+   * @return False if the read failed or the per-core lines were truncated
+   */
+  bool read() {
+    auto length = ::pread(fd_, buffer_.data(), buffer_.size(), 0);
+    if (length <= 0) return false;
+
+    std::fill(seen_.begin(), seen_.end(), false);
+
+    const char* line = buffer_.data();
+    const char* end  = line + length;
+
+    /* Skips the aggregate "cpu " line. */
+    line = details::find_newline(line, end);
+    if (line == end) return false;
+
+    /* The per-core lines end the file, unless the buffer was filled. */
+    auto complete = static_cast<std::size_t>(length) < buffer_.size();
+
+    for (++line; end - line >= 4;) {
+      if (std::memcmp(line, "cpu", 3) != 0) {
+        complete = true;
+        break;
+      }
+
+      auto eol = details::find_newline(line, end);
+      if (eol == end) return false;
+
+      std::uint64_t cpu;
+      auto* field = details::parse_field(line + 3, eol, cpu);
+
+      if (cpu < slots_.size() && slots_[cpu] >= 0) {
+        auto slot   = static_cast<std::size_t>(slots_[cpu]);
+        auto* value = &parsed_[slot * fields];
+        for (std::size_t i = 0; i < fields; ++i)
+          field = details::parse_field(field, eol, value[i]);
+        seen_[slot] = true;
+      }
+
+      line = eol + 1;
+    }
+
+    if (!complete) return false;
+
+    commit();
+    return true;
+  }
+
+  /* @brief The core numbers, in the order of the arrays */
+  const std::vector<unsigned>& cores() const { return cores_; }
+  const std::vector<std::uint64_t>& busy() const { return busy_; }
+  const std::vector<std::uint64_t>& total() const { return total_; }
+  const std::vector<std::uint64_t>& busy_delta() const { return busy_delta_; }
+  const std::vector<std::uint64_t>& total_delta() const {
+    return total_delta_;
+  }
+
+ private:
+  /* Idle and iowait, the fields not counted as busy. */
+  static bool is_idle(std::size_t field) { return field == 3 || field == 4; }
+
+  /**
+   * @brief Updates the times and deltas from the parsed lines
+   */
+  void commit() {
+    for (std::size_t slot = 0; slot < cores_.size(); ++slot) {
+      busy_delta_[slot]  = 0;
+      total_delta_[slot] = 0;
+      if (!seen_[slot]) continue;
+
+      auto* last  = &times_[slot * fields];
+      auto* value = &parsed_[slot * fields];
+      auto busy   = std::uint64_t{0};
+      auto idle   = std::uint64_t{0};
+
+      for (std::size_t i = 0; i < fields; ++i) {
+        auto delta = value[i] > last[i] ? value[i] - last[i] : 0;
+        if (is_idle(i)) {
+          idle += value[i];
+          total_delta_[slot] += delta;
+        } else {
+          busy += value[i];
+          busy_delta_[slot] += delta;
+        }
+        last[i] = value[i];
+      }
+
+      total_delta_[slot] += busy_delta_[slot];
+      busy_[slot]  = busy;
+      total_[slot] = busy + idle;
+    }
+  }
+
+  /**
+   * @brief Finds the cores and sizes the buffer
+   * @details The buffer holds the per-core lines with room for their
+   *          fields to grow by several digits each.
+   */
+  void discover() {
+    std::string contents;
+    char chunk[4096];
+    for (off_t offset = 0;;) {
+      auto length = ::pread(fd_, chunk, sizeof(chunk), offset);
+      if (length <= 0) break;
+      contents.append(chunk, static_cast<std::size_t>(length));
+      offset += length;
+    }
+
+    auto position = contents.find('\n');
+    while (position != std::string::npos &&
+           contents.compare(position + 1, 3, "cpu") == 0) {
+      std::uint64_t cpu;
+      details::parse_field(contents.data() + position + 4,
+                           contents.data() + contents.size(), cpu);
+      if (cpu >= slots_.size()) slots_.resize(cpu + 1, -1);
+      slots_[cpu] = static_cast<int>(cores_.size());
+      cores_.push_back(static_cast<unsigned>(cpu));
+      position = contents.find('\n', position + 1);
+    }
+
+    if (cores_.empty())
+      throw std::runtime_error("no per-core lines in /proc/stat");
+
+    auto section = position == std::string::npos ? contents.size() : position;
+    buffer_.resize(section + cores_.size() * 64 + 4096);
+  }
+
+  int fd_{-1};
+  std::vector<char> buffer_;
+  std::vector<int> slots_;  //! positions indexed by core number, or -1
+  std::vector<unsigned> cores_;
+  std::vector<std::uint64_t> times_;   //! fields of the last read, per core
+  std::vector<std::uint64_t> parsed_;  //! fields being parsed, per core
+  std::vector<bool> seen_;             //! cores present in the parsed read
+  std::vector<std::uint64_t> busy_;
+  std::vector<std::uint64_t> total_;
+  std::vector<std::uint64_t> busy_delta_;
+  std::vector<std::uint64_t> total_delta_;
+};
+
+}  // namespace exot::apps::utilities
@@ -0,0 +1,315 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/schedule_file.h
+ * @author     Bruno Klopott
+ * @brief      Text and binary schedule formats, and a memory-mapped view of
+ *             binary schedules.
+ *
+ * A text schedule contains one token per line: a duration followed by a
+ * subtoken, separated by a comma or whitespace. Integral subtokens are
+ * decimal or hexadecimal numbers; other subtokens, e.g. std::bitset, are
+ * read with their operator>>, such that "1010" is a bitset of four bits, as
+ * in the original schedule reader. A binary schedule consists
+ * of a header followed by fixed-size records:
+ *
+ *   | magic "EXOTSCHD" | version u32 | reserved u32 | record count u64 |
+ *   | reserved u64 |
+ *   | duration i64, in ns | payload u64 |   (once per token)
+ *
+ * Binary schedules are mapped into memory and read without copies.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace exot::apps::utilities {
+
+inline constexpr char schedule_magic[8] = {'E', 'X', 'O', 'T',
+                                           'S', 'C', 'H', 'D'};
+inline constexpr std::uint32_t schedule_version = 1;
+
+struct schedule_header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved0;
+  std::uint64_t count;
+  std::uint64_t reserved1;
+};
+
+struct schedule_record {
+  std::int64_t duration;  //! duration in nanoseconds
+  std::uint64_t payload;  //! the subtoken
+};
+
+static_assert(sizeof(schedule_header) == 32, "schedule header must be packed");
+static_assert(sizeof(schedule_record) == 16, "schedule record must be packed");
+
+/**
+ * @brief A line of a text schedule with the subtoken not yet parsed
+ */
+struct schedule_text_record {
+  std::int64_t duration;  //! duration in nanoseconds
+  std::string payload;    //! the subtoken text
+};
+
+/**
+ * @brief Parses a subtoken of a text schedule
+ * @note  Integral subtokens are read as numbers, other types with their
+ *        operator>>, which ignores "hex" for std::bitset.
+ *
+ * @param  text The subtoken text
+ * @param  hex  Is an integral subtoken given in hexadecimal?
+ * @return The subtoken
+ */
+template <typename Subtoken>
+inline Subtoken parse_subtoken(const std::string& text, bool hex = false) {
+  if constexpr (std::is_integral_v<Subtoken>) {
+    return static_cast<Subtoken>(std::stoull(text, nullptr, hex ? 16 : 10));
+  } else {
+    std::istringstream stream{text};
+    if (hex) stream >> std::hex;
+
+    Subtoken subtoken;
+    if (!(stream >> subtoken))
+      throw std::invalid_argument("malformed subtoken: " + text);
+    return subtoken;
+  }
+}
+
+/**
+ * @brief Splits a single line of a text schedule
+ *
+ * @param  line     The line
+ * @param  unit     The duration unit in nanoseconds, e.g. 1e3 for us
+ * @return The duration and the subtoken text, or nullopt for empty lines
+ *         and comments
+ */
+inline std::optional<schedule_text_record> split_schedule_line(
+    const std::string& line, double unit = 1.0) {
+  auto begin = line.find_first_not_of(" \t\r");
+  if (begin == std::string::npos || line[begin] == '#') return std::nullopt;
+
+  auto separator = line.find_first_of(", \t", begin);
+  if (separator == std::string::npos)
+    throw std::invalid_argument("missing subtoken in line: " + line);
+
+  auto payload_begin = line.find_first_not_of(", \t", separator);
+  if (payload_begin == std::string::npos)
+    throw std::invalid_argument("missing subtoken in line: " + line);
+
+  try {
+    auto duration = std::stod(line.substr(begin, separator - begin));
+    if (!(duration >= 0.0)) throw std::invalid_argument("negative duration");
+
+    auto payload_end = line.find_last_not_of(" \t\r");
+    return schedule_text_record{
+        static_cast<std::int64_t>(std::llround(duration * unit)),
+        line.substr(payload_begin, payload_end + 1 - payload_begin)};
+  } catch (const std::exception&) {
+    throw std::invalid_argument("malformed schedule line: " + line);
+  }
+}
+
+/**
+ * @brief Parses a single line of a text schedule
+ *
+ * @param  line     The line
+ * @param  unit     The duration unit in nanoseconds, e.g. 1e3 for us
+ * @param  hex      Is the subtoken given in hexadecimal?
+ * @return The record, or nullopt for empty lines and comments
+ */
+template <typename Subtoken = std::uint64_t>
+inline std::optional<schedule_record> parse_schedule_line(
+    const std::string& line, double unit = 1.0, bool hex = false) {
+  auto fields = split_schedule_line(line, unit);
+  if (!fields) return std::nullopt;
+
+  try {
+    auto subtoken = parse_subtoken<Subtoken>(fields->payload, hex);
+    if constexpr (std::is_integral_v<Subtoken>) {
+      return schedule_record{fields->duration,
+                             static_cast<std::uint64_t>(subtoken)};
+    } else {
+      return schedule_record{fields->duration, subtoken.to_ullong()};
+    }
+  } catch (const std::exception&) {
+    throw std::invalid_argument("malformed schedule line: " + line);
+  }
+}
+
+/**
+ * @brief Gets the duration unit in nanoseconds from its name
+ */
+inline double schedule_unit(const std::string& name) {
+  if (name == "ns") return 1.0;
+  if (name == "us") return 1e3;
+  if (name == "ms") return 1e6;
+  if (name == "s") return 1e9;
+  throw std::invalid_argument("unknown duration unit: " + name);
+}
+
+/**
+ * @brief Converts a record payload to a subtoken
+ * @note  Supports integral subtokens and types constructible from an
+ *        unsigned long long, like std::bitset.
+ */
+template <typename Subtoken>
+inline Subtoken to_subtoken(std::uint64_t payload) {
+  if constexpr (std::is_integral_v<Subtoken>) {
+    return static_cast<Subtoken>(payload);
+  } else {
+    static_assert(std::is_constructible_v<Subtoken, unsigned long long>,
+                  "binary schedules require integral or bitset subtokens");
+    return Subtoken(static_cast<unsigned long long>(payload));
+  }
+}
+
+/**
+ * @brief Checks if a file starts with the binary schedule magic
+ */
+inline bool is_binary_schedule(const std::string& filename) {
+  auto fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+
+  char magic[sizeof(schedule_magic)] = {};
+  auto length = ::read(fd, magic, sizeof(magic));
+  ::close(fd);
+
+  return length == sizeof(magic) &&
+         std::memcmp(magic, schedule_magic, sizeof(magic)) == 0;
+}
+
+/**
+ * @brief A read-only, memory-mapped view of a binary schedule
+ */
+class schedule_view {
+ public:
+  /**
+   * @param filename  The binary schedule
+   * @param populate  Fault in all pages when mapping?
+   */
+  explicit schedule_view(const std::string& filename, bool populate = false) {
+    auto fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      throw std::runtime_error("failed to open " + filename + ": " +
+                               std::strerror(errno));
+
+    struct ::stat info;
+    if (::fstat(fd, &info) != 0) {
+      ::close(fd);
+      throw std::runtime_error("failed to stat " + filename);
+    }
+
+    size_ = static_cast<std::size_t>(info.st_size);
+    if (size_ < sizeof(schedule_header)) {
+      ::close(fd);
+      throw std::runtime_error(filename + " is not a binary schedule");
+    }
+
+    mapping_ = ::mmap(nullptr, size_, PROT_READ,
+                      MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+    ::close(fd);
+
+    if (mapping_ == MAP_FAILED)
+      throw std::runtime_error("failed to map " + filename + ": " +
+                               std::strerror(errno));
+
+    ::madvise(mapping_, size_, MADV_SEQUENTIAL);
+
+    const auto* header = static_cast<const schedule_header*>(mapping_);
+    if (std::memcmp(header->magic, schedule_magic, sizeof(schedule_magic)) !=
+            0 ||
+        header->version != schedule_version) {
+      ::munmap(mapping_, size_);
+      throw std::runtime_error(filename + " is not a binary schedule");
+    }
+
+    count_ = header->count;
+    if (sizeof(schedule_header) + count_ * sizeof(schedule_record) > size_) {
+      ::munmap(mapping_, size_);
+      throw std::runtime_error(filename + " is truncated");
+    }
+
+    records_ = reinterpret_cast<const schedule_record*>(
+        static_cast<const char*>(mapping_) + sizeof(schedule_header));
+  }
+
+  ~schedule_view() { ::munmap(mapping_, size_); }
+
+  schedule_view(const schedule_view&) = delete;
+  schedule_view& operator=(const schedule_view&) = delete;
+
+  std::size_t size() const { return count_; }
+  const schedule_record& operator[](std::size_t index) const {
+    return records_[index];
+  }
+
+  /**
+   * @brief Hints that records in a range will be read soon
+   * @details Issues a cache prefetch for the first record of the range and
+   *          asks the kernel to read ahead the pages backing the range.
+   */
+  void prefetch(std::size_t from, std::size_t count) const {
+    if (from >= count_) return;
+    count = std::min(count, count_ - from);
+
+    __builtin_prefetch(&records_[from]);
+
+    static const auto page =
+        static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    auto begin =
+        reinterpret_cast<std::uintptr_t>(&records_[from]) & ~(page - 1);
+    auto end = reinterpret_cast<std::uintptr_t>(&records_[from + count]);
+    ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+  }
+
+ private:
+  void* mapping_{nullptr};
+  std::size_t size_{0};
+  std::size_t count_{0};
+  const schedule_record* records_{nullptr};
+};
+
+}  // namespace exot::apps::utilities
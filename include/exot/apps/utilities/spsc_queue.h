@@ -0,0 +1,128 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/spsc_queue.h
+ * @author     Bruno Klopott
+ * @brief      A bounded, lock-free single-producer single-consumer queue.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief A bounded single-producer single-consumer queue
+ * @details The capacity is rounded up to a power of two. The producer and
+ *          consumer indices live on separate cache lines, and each side
+ *          keeps a cached copy of the other side's index, such that the
+ *          shared lines are only touched when the cached view runs out.
+ *          Neither operation blocks, locks, or makes system calls.
+ *
+ * @tparam T A default-constructible, movable type
+ */
+template <typename T>
+class spsc_queue {
+ public:
+  explicit spsc_queue(std::size_t capacity) {
+    if (capacity == 0)
+      throw std::logic_error("spsc_queue capacity must be positive");
+
+    capacity_ = 1;
+    while (capacity_ < capacity) capacity_ <<= 1;
+    mask_  = capacity_ - 1;
+    slots_ = std::make_unique<T[]>(capacity_);
+  }
+
+  spsc_queue(const spsc_queue&) = delete;
+  spsc_queue& operator=(const spsc_queue&) = delete;
+
+  /**
+   * @brief Pushes an element, only to be called by the producer
+   * @return False if the queue is full
+   */
+  bool try_push(T value) {
+    auto head = producer_.index.load(std::memory_order_relaxed);
+    if (head - producer_.cached >= capacity_) {
+      producer_.cached = consumer_.index.load(std::memory_order_acquire);
+      if (head - producer_.cached >= capacity_) return false;
+    }
+
+    slots_[head & mask_] = std::move(value);
+    producer_.index.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Pops an element, only to be called by the consumer
+   * @return False if the queue is empty
+   */
+  bool try_pop(T& value) {
+    auto tail = consumer_.index.load(std::memory_order_relaxed);
+    if (tail == consumer_.cached) {
+      consumer_.cached = producer_.index.load(std::memory_order_acquire);
+      if (tail == consumer_.cached) return false;
+    }
+
+    value = std::move(slots_[tail & mask_]);
+    consumer_.index.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Gets the approximate number of queued elements
+   */
+  std::size_t size() const {
+    auto head = producer_.index.load(std::memory_order_acquire);
+    auto tail = consumer_.index.load(std::memory_order_acquire);
+    return static_cast<std::size_t>(head - tail);
+  }
+
+  std::size_t capacity() const { return capacity_; }
+
+ private:
+  struct alignas(64) side {
+    std::atomic<std::uint64_t> index{0};
+    std::uint64_t cached{0};  //! the other side's index as last seen
+  };
+
+  side producer_;
+  side consumer_;
+  std::size_t capacity_;
+  std::size_t mask_;
+  std::unique_ptr<T[]> slots_;
+};
+
+}  // namespace exot::apps::utilities
@@ -0,0 +1,324 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/sysfs_batch.h
+ * @author     Bruno Klopott
+ * @brief      Reading sets of numeric sysfs attributes in a batch, with
+ *             pread or with io_uring.
+ *
+ * With the "pread" backend, every attribute costs a single pread on a
+ * persistent file descriptor into a preallocated buffer. With the
+ * "io_uring" backend, the reads of all attributes are submitted and waited
+ * for with a single io_uring_enter, which removes the per-attribute system
+ * call on hosts with many cores. The ring is set up without liburing,
+ * through the raw system calls, and the backend falls back to pread if the
+ * kernel does not support io_uring or its read operation.
+ */
+
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* IORING_OP_READ is an enumerator and cannot be tested with defined(); it
+ * was added in Linux 5.6 together with IORING_FEAT_CUR_PERSONALITY, which
+ * is a macro. Older headers would fail to compile the read submission. */
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#if defined(IORING_FEAT_CUR_PERSONALITY)
+#define EXOT_APPS_HAVE_IO_URING 1
+#endif
+#endif
+
+#include <exot/apps/utilities/sysfs_reader.h>
+
+namespace exot::apps::utilities {
+
+enum class sysfs_backend { pread, io_uring };
+
+inline sysfs_backend parse_sysfs_backend(const std::string& name) {
+  if (name == "pread") return sysfs_backend::pread;
+  if (name == "io_uring") return sysfs_backend::io_uring;
+  throw std::logic_error("unknown sysfs backend: " + name);
+}
+
+inline const char* to_string(sysfs_backend backend) {
+  return backend == sysfs_backend::io_uring ? "io_uring" : "pread";
+}
+
+#if defined(EXOT_APPS_HAVE_IO_URING)
+
+namespace details {
+
+/**
+ * @brief A minimal io_uring for batches of reads at offset 0
+ */
+class io_ring {
+ public:
+  explicit io_ring(unsigned entries) {
+    ::io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0)
+      throw std::runtime_error(std::string{"io_uring_setup failed: "} +
+                               std::strerror(errno));
+
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(::io_uring_cqe);
+    single_ = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_) sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+    sqes_size_ = params.sq_entries * sizeof(::io_uring_sqe);
+
+    sq_   = map(sq_size_, IORING_OFF_SQ_RING);
+    cq_   = single_ ? sq_ : map(cq_size_, IORING_OFF_CQ_RING);
+    sqes_ = static_cast<::io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+
+    auto* sq  = static_cast<char*>(sq_);
+    auto* cq  = static_cast<char*>(cq_);
+    sq_tail_  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_  = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    cq_head_  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_  = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_     = reinterpret_cast<::io_uring_cqe*>(cq + params.cq_off.cqes);
+    capacity_ = params.sq_entries;
+
+    /* Submission entries are used in ring order, so the indirection array
+     * is the identity and is filled once. */
+    auto* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; ++i) array[i] = i;
+  }
+
+  ~io_ring() {
+    if (sqes_ != nullptr) ::munmap(sqes_, sqes_size_);
+    if (cq_ != nullptr && !single_) ::munmap(cq_, cq_size_);
+    if (sq_ != nullptr) ::munmap(sq_, sq_size_);
+    if (fd_ >= 0) ::close(fd_);
+  }
+
+  io_ring(const io_ring&) = delete;
+  io_ring& operator=(const io_ring&) = delete;
+
+  /**
+   * @brief Reads from a set of file descriptors at offset 0
+   * @details Submits up to capacity() reads per io_uring_enter, and waits
+   *          for their completion in the same call.
+   *
+   * @param complete Called with the index and the result of each read
+   * @return False if the submission failed
+   */
+  template <typename Complete>
+  bool read(const int* fds, char* buffers, unsigned length, std::size_t count,
+            Complete&& complete) {
+    for (std::size_t first = 0; first < count; first += capacity_) {
+      auto batch = static_cast<unsigned>(
+          std::min<std::size_t>(capacity_, count - first));
+
+      auto tail = *sq_tail_;
+      for (unsigned k = 0; k < batch; ++k) {
+        auto& sqe = sqes_[(tail + k) & sq_mask_];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode    = IORING_OP_READ;
+        sqe.fd        = fds[first + k];
+        sqe.addr      = reinterpret_cast<std::uint64_t>(
+            buffers + (first + k) * length);
+        sqe.len       = length;
+        sqe.off       = 0;
+        sqe.user_data = first + k;
+      }
+      __atomic_store_n(sq_tail_, tail + batch, __ATOMIC_RELEASE);
+
+      auto submitted = enter(batch, batch);
+      if (submitted < 0) return false;
+
+      for (unsigned seen = 0; seen < batch;) {
+        auto head = *cq_head_;
+        auto end  = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        if (head == end) {
+          if (enter(0, batch - seen) < 0) return false;
+          continue;
+        }
+
+        for (; head != end; ++head, ++seen) {
+          const auto& cqe = cqes_[head & cq_mask_];
+          complete(static_cast<std::size_t>(cqe.user_data), cqe.res);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+      }
+    }
+
+    return true;
+  }
+
+  unsigned capacity() const { return capacity_; }
+
+ private:
+  void* map(std::size_t size, std::uint64_t offset) {
+    auto* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd_,
+                           static_cast<off_t>(offset));
+    if (address == MAP_FAILED)
+      throw std::runtime_error(std::string{"io_uring mmap failed: "} +
+                               std::strerror(errno));
+    return address;
+  }
+
+  int enter(unsigned submit, unsigned wait) {
+    int result;
+    do {
+      result = static_cast<int>(::syscall(__NR_io_uring_enter, fd_, submit,
+                                          wait, IORING_ENTER_GETEVENTS,
+                                          nullptr, 0));
+    } while (result < 0 && errno == EINTR);
+    return result;
+  }
+
+  int fd_{-1};
+  bool single_{false};
+  std::size_t sq_size_{0}, cq_size_{0}, sqes_size_{0};
+  void* sq_{nullptr};
+  void* cq_{nullptr};
+  ::io_uring_sqe* sqes_{nullptr};
+  ::io_uring_cqe* cqes_{nullptr};
+  unsigned* sq_tail_{nullptr};
+  unsigned* cq_head_{nullptr};
+  unsigned* cq_tail_{nullptr};
+  unsigned sq_mask_{0}, cq_mask_{0}, capacity_{0};
+};
+
+}  // namespace details
+
+#endif
+
+/**
+ * @brief A set of numeric sysfs attributes read together
+ */
+class sysfs_batch {
+ public:
+  using value_type = std::optional<std::int64_t>;
+
+  static constexpr unsigned buffer_size = 32;
+
+  /**
+   * @param paths   The attributes, opened once
+   * @param backend The requested backend, see backend() for the one used
+   */
+  explicit sysfs_batch(const std::vector<std::string>& paths,
+                       sysfs_backend backend = sysfs_backend::pread)
+      : buffers_(paths.size() * buffer_size), lengths_(paths.size()) {
+    for (const auto& path : paths) {
+      files_.emplace_back(path);
+      fds_.push_back(files_.back().fd());
+    }
+
+#if defined(EXOT_APPS_HAVE_IO_URING)
+    if (backend == sysfs_backend::io_uring && !files_.empty()) {
+      try {
+        ring_ = std::make_unique<details::io_ring>(static_cast<unsigned>(
+            std::min<std::size_t>(files_.size(), max_ring_entries)));
+        /* Kernels before 5.6 fail the read operation with -EINVAL. */
+        if (!read_ring() || lengths_[0] < 0) ring_.reset();
+      } catch (const std::runtime_error&) { ring_.reset(); }
+    }
+#else
+    static_cast<void>(backend);
+#endif
+  }
+
+  /**
+   * @brief Reads all attributes
+   * @param values Resized to size(), nullopt for failed reads
+   */
+  void read(std::vector<value_type>& values) {
+    values.resize(files_.size());
+
+#if defined(EXOT_APPS_HAVE_IO_URING)
+    if (ring_ && read_ring()) {
+      for (std::size_t i = 0; i < files_.size(); ++i) values[i] = parse(i);
+      return;
+    }
+#endif
+
+    for (std::size_t i = 0; i < files_.size(); ++i) {
+      lengths_[i] = static_cast<int>(
+          ::pread(fds_[i], &buffers_[i * buffer_size], buffer_size, 0));
+      values[i] = parse(i);
+    }
+  }
+
+  sysfs_backend backend() const {
+#if defined(EXOT_APPS_HAVE_IO_URING)
+    if (ring_) return sysfs_backend::io_uring;
+#endif
+    return sysfs_backend::pread;
+  }
+
+  std::size_t size() const { return files_.size(); }
+  const std::string& path(std::size_t i) const { return files_[i].path(); }
+
+ private:
+  static constexpr std::size_t max_ring_entries = 256;
+
+  value_type parse(std::size_t i) const {
+    if (lengths_[i] <= 0) return std::nullopt;
+    const auto* begin = &buffers_[i * buffer_size];
+    return parse_integer(begin, begin + lengths_[i]);
+  }
+
+#if defined(EXOT_APPS_HAVE_IO_URING)
+  bool read_ring() {
+    return ring_->read(fds_.data(), buffers_.data(), buffer_size,
+                       files_.size(), [this](std::size_t i, int result) {
+                         lengths_[i] = result;
+                       });
+  }
+
+  std::unique_ptr<details::io_ring> ring_;
+#endif
+
+  std::vector<sysfs_value> files_;
+  std::vector<int> fds_;
+  std::vector<char> buffers_;
+  std::vector<int> lengths_;
+};
+
+}  // namespace exot::apps::utilities
@@ -0,0 +1,155 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/sysfs_reader.h
+ * @author     Bruno Klopott
+ * @brief      Reading numeric sysfs attributes through persistent file
+ *             descriptors.
+ *
+ * Sysfs attributes are regenerated on every read from offset 0, so a file
+ * can stay open for the lifetime of a meter and be re-read with pread,
+ * which avoids the open/read/close sequence of stream-based access.
+ */
+
+#pragma once
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief Parses a decimal integer, skipping leading whitespace
+ * @return The value, or nullopt if no digits were found
+ */
+inline std::optional<std::int64_t> parse_integer(const char* begin,
+                                                 const char* end) {
+  while (begin != end && (*begin == ' ' || *begin == '\t')) ++begin;
+
+  auto negative = begin != end && *begin == '-';
+  if (negative) ++begin;
+
+  if (begin == end || *begin < '0' || *begin > '9') return std::nullopt;
+
+  std::int64_t value = 0;
+  for (; begin != end && *begin >= '0' && *begin <= '9'; ++begin)
+    value = value * 10 + (*begin - '0');
+
+  return negative ? -value : value;
+}
+
+/**
+ * @brief A numeric sysfs attribute kept open for repeated reads
+ */
+class sysfs_value {
+ public:
+  explicit sysfs_value(const std::string& path) : path_{path} {
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0)
+      throw std::runtime_error("failed to open " + path + ": " +
+                               std::strerror(errno));
+  }
+
+  ~sysfs_value() {
+    if (fd_ >= 0) ::close(fd_);
+  }
+
+  sysfs_value(sysfs_value&& other) noexcept
+      : path_{std::move(other.path_)}, fd_{std::exchange(other.fd_, -1)} {}
+  sysfs_value& operator=(sysfs_value&& other) noexcept {
+    std::swap(path_, other.path_);
+    std::swap(fd_, other.fd_);
+    return *this;
+  }
+
+  sysfs_value(const sysfs_value&) = delete;
+  sysfs_value& operator=(const sysfs_value&) = delete;
+
+  /**
+   * @brief Reads the attribute as an integer
+   * @return The value, or nullopt if the read failed
+   */
+  std::optional<std::int64_t> read() const {
+    char buffer[32];
+    auto length = ::pread(fd_, buffer, sizeof(buffer), 0);
+    if (length <= 0) return std::nullopt;
+    return parse_integer(buffer, buffer + length);
+  }
+
+  int fd() const { return fd_; }
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+  int fd_{-1};
+};
+
+/**
+ * @brief Lists the numeric suffixes of directory entries with a prefix
+ * @details For example, the suffixes of "thermal_zone" entries in
+ *          /sys/class/thermal are the thermal zone numbers.
+ *
+ * @return The sorted suffixes
+ */
+inline std::vector<unsigned> list_numbered_entries(const std::string& directory,
+                                                   const std::string& prefix) {
+  std::vector<unsigned> numbers;
+
+  auto* dir = ::opendir(directory.c_str());
+  if (dir == nullptr) return numbers;
+
+  while (auto* entry = ::readdir(dir)) {
+    auto name = std::string{entry->d_name};
+    if (name.compare(0, prefix.size(), prefix) != 0) continue;
+
+    auto suffix = name.substr(prefix.size());
+    if (suffix.empty() ||
+        suffix.find_first_not_of("0123456789") != std::string::npos)
+      continue;
+
+    numbers.push_back(static_cast<unsigned>(std::stoul(suffix)));
+  }
+
+  ::closedir(dir);
+  std::sort(numbers.begin(), numbers.end());
+  return numbers;
+}
+
+}  // namespace exot::apps::utilities
@@ -0,0 +1,171 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/timing_recorder.h
+ * @author     Bruno Klopott
+ * @brief      Recording and summarising how late periodic events happen.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief Records the lateness of events against their intended times
+ * @details The sample buffer is allocated and touched at construction, and
+ *          recording is a bounds check and a store, such that a recorder
+ *          can be used on timing-critical paths. A recorder must only be
+ *          used by a single thread. Events beyond the capacity are counted
+ *          but not stored.
+ */
+class timing_recorder {
+ public:
+  struct summary {
+    std::uint64_t count;
+    std::uint64_t dropped;
+    std::int64_t min;
+    std::int64_t p50;
+    std::int64_t p99;
+    std::int64_t p999;
+    std::int64_t max;
+    double mean;
+  };
+
+  explicit timing_recorder(std::size_t capacity) : samples_(capacity, 0) {
+    if (capacity == 0)
+      throw std::logic_error("timing_recorder capacity must be positive");
+  }
+
+  /**
+   * @brief Records an event
+   *
+   * @param intended The intended time in ns
+   * @param actual   The actual time in ns
+   */
+  void record(std::int64_t intended, std::int64_t actual) noexcept {
+    if (size_ < samples_.size()) {
+      samples_[size_++] = actual - intended;
+    } else {
+      ++dropped_;
+    }
+  }
+
+  /**
+   * @brief Summarises the recorded lateness
+   * @note  Sorts the recorded samples, should only be called at exit.
+   */
+  summary summarise() {
+    auto first = samples_.begin();
+    auto last  = first + size_;
+    std::sort(first, last);
+
+    auto at = [&](double q) -> std::int64_t {
+      if (size_ == 0) return 0;
+      auto rank = static_cast<std::size_t>(std::ceil(q * size_));
+      return first[std::clamp<std::size_t>(rank, 1, size_) - 1];
+    };
+
+    double sum = 0.0;
+    for (auto it = first; it != last; ++it) sum += static_cast<double>(*it);
+
+    return summary{size_,   dropped_, at(0.0),   at(0.5), at(0.99),
+                   at(0.999), at(1.0), size_ ? sum / size_ : 0.0};
+  }
+
+  /**
+   * @brief Formats a summary for logging
+   */
+  static std::string format(const summary& s) {
+    return fmt::format(
+        "{} events ({} dropped), lateness [ns] p50: {}, p99: {}, p99.9: {}, "
+        "max: {}, mean: {:.0f}",
+        s.count, s.dropped, s.p50, s.p99, s.p999, s.max, s.mean);
+  }
+
+  /**
+   * @brief Writes the summary and a histogram of the lateness to a file
+   * @details The file is a CSV with one row per bucket. The first bucket
+   *          holds early events, the following buckets hold lateness in
+   *          [0, 1) and [2^k, 2^(k+1)) ns. The summary is written as a
+   *          comment line.
+   */
+  void write(const std::string& filename, const std::string& source) {
+    auto s = summarise();
+
+    std::vector<std::uint64_t> buckets(65, 0);
+    for (std::size_t i = 0; i < size_; ++i) {
+      auto value = samples_[i];
+      if (value < 0) {
+        ++buckets[0];
+      } else {
+        auto bucket = 1u;
+        for (auto v = static_cast<std::uint64_t>(value); v != 0; v >>= 1)
+          ++bucket;
+        ++buckets[std::min(bucket, 64u)];
+      }
+    }
+
+    auto file = std::unique_ptr<std::FILE, decltype(&std::fclose)>{
+        std::fopen(filename.c_str(), "w"), &std::fclose};
+    if (!file) throw std::runtime_error("failed to open " + filename);
+
+    fmt::print(file.get(),
+               "# source: {}, count: {}, dropped: {}, min: {}, p50: {}, p99: "
+               "{}, p99.9: {}, max: {}, mean: {:.1f}\n",
+               source, s.count, s.dropped, s.min, s.p50, s.p99, s.p999, s.max,
+               s.mean);
+    fmt::print(file.get(), "lower,upper,count\n");
+    fmt::print(file.get(), "{},{},{}\n", s.min < 0 ? s.min : 0, 0, buckets[0]);
+    for (auto k = 1u; k < buckets.size(); ++k) {
+      auto lower = k == 1 ? 0ull : 1ull << (k - 2);
+      auto upper = 1ull << (k - 1);
+      if (buckets[k] != 0 || lower <= static_cast<std::uint64_t>(
+                                        std::max<std::int64_t>(s.max, 0)))
+        fmt::print(file.get(), "{},{},{}\n", lower, upper, buckets[k]);
+    }
+  }
+
+ private:
+  std::vector<std::int64_t> samples_;
+  std::size_t size_{0};
+  std::uint64_t dropped_{0};
+};
+
+}  // namespace exot::apps::utilities
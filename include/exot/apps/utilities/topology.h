@@ -0,0 +1,110 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file exot/apps/utilities/topology.h
+ * @author     Bruno Klopott
+ * @brief      Package and core topology of online CPUs, from sysfs.
+ */
+
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <exot/apps/utilities/sysfs_reader.h>
+
+namespace exot::apps::utilities {
+
+/**
+ * @brief The position of a CPU in the package and core topology
+ */
+struct cpu_topology {
+  unsigned cpu;
+  unsigned package;  //! physical package id
+  unsigned core;     //! core id, unique within the package
+};
+
+/**
+ * @brief Gets the topology of all CPUs with a topology directory
+ * @details Offline CPUs have no topology directory and are omitted.
+ */
+inline std::vector<cpu_topology> cpu_topologies() {
+  static const auto base = std::string{"/sys/devices/system/cpu"};
+
+  std::vector<cpu_topology> cpus;
+  for (auto cpu : list_numbered_entries(base, "cpu")) {
+    try {
+      auto directory = fmt::format("{}/cpu{}/topology", base, cpu);
+      auto package =
+          sysfs_value{directory + "/physical_package_id"}.read().value_or(0);
+      auto core = sysfs_value{directory + "/core_id"}.read().value_or(cpu);
+      cpus.push_back({cpu, static_cast<unsigned>(package),
+                      static_cast<unsigned>(core)});
+    } catch (const std::runtime_error&) { continue; }
+  }
+
+  return cpus;
+}
+
+/**
+ * @brief Selects the first CPU of every package
+ */
+inline std::vector<cpu_topology> one_per_package(
+    const std::vector<cpu_topology>& cpus) {
+  std::vector<cpu_topology> selected;
+  for (const auto& entry : cpus) {
+    auto seen = false;
+    for (const auto& other : selected)
+      seen = seen || other.package == entry.package;
+    if (!seen) selected.push_back(entry);
+  }
+  return selected;
+}
+
+/**
+ * @brief Selects the first CPU of every physical core, i.e. one hardware
+ *        thread per core
+ */
+inline std::vector<cpu_topology> one_per_core(
+    const std::vector<cpu_topology>& cpus) {
+  std::vector<cpu_topology> selected;
+  for (const auto& entry : cpus) {
+    auto seen = false;
+    for (const auto& other : selected)
+      seen = seen ||
+             (other.package == entry.package && other.core == entry.core);
+    if (!seen) selected.push_back(entry);
+  }
+  return selected;
+}
+
+}  // namespace exot::apps::utilities
@@ -38,14 +38,14 @@
 
 #if defined(__x86_64__) || defined(__aarch64__)
 
-#include <exot/components/meter_host_logger.h>
+#include <exot/apps/components/meter_host_sink.h>
 #include <exot/meters/cache.h>
 #include <exot/utilities/main.h>
 
 using namespace exot;
 
-using meter_t =
-    components::meter_host_logger<std::chrono::nanoseconds, modules::cache_ff>;
+using meter_t = apps::components::meter_host_sink<std::chrono::nanoseconds,
+                                                  modules::cache_ff>;
 
 int main(int argc, char** argv) {
   return utilities::cli_wrapper<meter_t>(argc, argv);
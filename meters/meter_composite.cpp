@@ -0,0 +1,68 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file meters/meter_composite.cpp
+ * @author     Bruno Klopott
+ * @brief      A meter application combining all system-level modules, with
+ *             the active modules selected at runtime.
+ * @note       Select modules via the "meters" list in the "meter" section of
+ *             the configuration, e.g. ["thermal_msr", "frequency_sysfs"].
+ *             Inactive modules are not constructed and not sampled.
+ */
+
+#include <chrono>
+
+#include <exot/apps/components/meter_host_sink.h>
+#include <exot/apps/modules/frequency_sysfs.h>
+#include <exot/apps/modules/thermal_sysfs.h>
+#include <exot/apps/modules/utilisation_procfs.h>
+#include <exot/meters/fan_procfs.h>
+#include <exot/meters/fan_sysfs.h>
+#include <exot/meters/frequency.h>
+#include <exot/utilities/main.h>
+
+#if defined(__x86_64__)
+#include <exot/apps/modules/power_msr.h>
+#include <exot/apps/modules/thermal_msr.h>
+#endif
+
+using namespace exot;
+
+using meter_t = apps::components::meter_host_sink<
+    std::chrono::nanoseconds,
+#if defined(__x86_64__)
+    apps::modules::thermal_msr, apps::modules::power_msr,
+#endif
+    apps::modules::thermal_sysfs, apps::modules::frequency_sysfs,
+    modules::frequency_rel, apps::modules::utilisation_procfs,
+    modules::fan_sysfs, modules::fan_procfs>;
+
+int main(int argc, char** argv) {
+  return utilities::cli_wrapper<meter_t>(argc, argv);
+}
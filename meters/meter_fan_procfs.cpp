@@ -35,14 +35,14 @@
 
 #include <chrono>
 
-#include <exot/components/meter_host_logger.h>
+#include <exot/apps/components/meter_host_sink.h>
 #include <exot/meters/fan_procfs.h>
 #include <exot/utilities/main.h>
 
 using namespace exot;
 
-using meter_t = components::meter_host_logger<std::chrono::nanoseconds,
-                                              modules::fan_procfs>;
+using meter_t = apps::components::meter_host_sink<std::chrono::nanoseconds,
+                                                  modules::fan_procfs>;
 
 int main(int argc, char** argv) {
   return utilities::cli_wrapper<meter_t>(argc, argv);
@@ -34,14 +34,15 @@
 
 #include <chrono>
 
-#include <exot/components/meter_host_logger.h>
-#include <exot/meters/frequency.h>
+#include <exot/apps/components/meter_host_sink.h>
+#include <exot/apps/modules/frequency_sysfs.h>
 #include <exot/utilities/main.h>
 
 using namespace exot;
 
-using meter_t = components::meter_host_logger<std::chrono::nanoseconds,
-                                              modules::frequency_sysfs>;
+using meter_t =
+    apps::components::meter_host_sink<std::chrono::nanoseconds,
+                                      apps::modules::frequency_sysfs>;
 
 int main(int argc, char** argv) {
   return utilities::cli_wrapper<meter_t>(argc, argv);
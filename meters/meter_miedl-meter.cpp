@@ -32,16 +32,18 @@
  * @brief      Measures utilisation, absolute and relative scaling frequencies.
  */
 
-#include <exot/components/meter_host_logger.h>
+#include <exot/apps/components/meter_host_sink.h>
+#include <exot/apps/modules/utilisation_procfs.h>
 #include <exot/meters/frequency.h>
-#include <exot/meters/utilisation.h>
 #include <exot/utilities/main.h>
 
 using namespace exot;
 
-using meter_t = components::meter_host_logger<
-    std::chrono::nanoseconds, modules::utilisation_procfs,
-    modules::frequency_sysfs, modules::frequency_rel>;
+using meter_t =
+    apps::components::meter_host_sink<std::chrono::nanoseconds,
+                                      apps::modules::utilisation_procfs,
+                                      modules::frequency_sysfs,
+                                      modules::frequency_rel>;
 
 int main(int argc, char** argv) {
   return utilities::cli_wrapper<meter_t>(argc, argv);
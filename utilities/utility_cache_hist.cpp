@@ -26,12 +26,23 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <numeric>
 #include <optional>
+#include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include <fmt/format.h>
 #include <fmt/ostream.h>
@@ -190,6 +201,203 @@ void flush(T& value) {
   }
 }
 
+/**
+ * @brief A fixed-bucket latency histogram with streaming statistics
+ * @details Values are accumulated into `bucket_count` buckets of equal width,
+ *          values beyond the last bucket are collected in an overflow bucket.
+ *          Mean and variance are computed online with Welford's algorithm,
+ *          percentiles are interpolated from the bucket counts.
+ */
+class histogram {
+ public:
+  histogram(return_t bucket_width, std::size_t bucket_count)
+      : width_{bucket_width}, buckets_(bucket_count + 1) {
+    if (bucket_width == 0)
+      throw std::logic_error("histogram bucket width must be non-zero");
+    if (bucket_count == 0)
+      throw std::logic_error("histogram bucket count must be non-zero");
+  }
+
+  /* Clears the histogram and changes the width of its buckets. */
+  void reset(return_t bucket_width) {
+    if (bucket_width == 0)
+      throw std::logic_error("histogram bucket width must be non-zero");
+    width_ = bucket_width;
+    reset();
+  }
+
+  void reset() {
+    std::fill(buckets_.begin(), buckets_.end(), 0ull);
+    count_ = 0;
+    mean_  = 0.0;
+    m2_    = 0.0;
+    min_   = std::numeric_limits<return_t>::max();
+    max_   = std::numeric_limits<return_t>::min();
+  }
+
+  inline void add(return_t value) {
+    auto index = std::min<std::size_t>(value / width_, buckets_.size() - 1);
+    ++buckets_[index];
+
+    ++count_;
+    auto delta = static_cast<double>(value) - mean_;
+    mean_ += delta / static_cast<double>(count_);
+    m2_ += delta * (static_cast<double>(value) - mean_);
+
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  /**
+   * @brief Gets the approximate value below which a fraction q of samples
+   *        fall, interpolated linearly within the bucket
+   *
+   * @param q The quantile, in range [0, 1]
+   */
+  double percentile(double q) const {
+    if (count_ == 0) return 0.0;
+
+    auto target     = q * static_cast<double>(count_);
+    auto cumulative = 0.0;
+
+    for (auto i = 0u; i < buckets_.size() - 1; ++i) {
+      auto in_bucket = static_cast<double>(buckets_[i]);
+      if (in_bucket != 0.0 && cumulative + in_bucket >= target) {
+        auto lower = static_cast<double>(bucket_lower(i));
+        auto value = lower + static_cast<double>(width_) *
+                                 (target - cumulative) / in_bucket;
+        return std::clamp(value, static_cast<double>(min_),
+                          static_cast<double>(max_));
+      }
+      cumulative += in_bucket;
+    }
+
+    return static_cast<double>(max_);
+  }
+
+  std::uint64_t count() const { return count_; }
+  double mean() const { return mean_; }
+  double variance() const {
+    return count_ > 1 ? m2_ / static_cast<double>(count_ - 1) : 0.0;
+  }
+  return_t min() const { return count_ != 0 ? min_ : 0; }
+  return_t max() const { return count_ != 0 ? max_ : 0; }
+
+  /* The last bucket is the overflow bucket. */
+  std::size_t buckets() const { return buckets_.size(); }
+  std::uint64_t bucket(std::size_t i) const { return buckets_.at(i); }
+  return_t bucket_lower(std::size_t i) const { return i * width_; }
+  return_t bucket_width() const { return width_; }
+  double overflow_fraction() const {
+    return count_ != 0 ? static_cast<double>(buckets_.back()) /
+                             static_cast<double>(count_)
+                       : 0.0;
+  }
+
+ private:
+  return_t width_;
+  std::vector<std::uint64_t> buckets_;
+  std::uint64_t count_{0};
+  double mean_{0.0};
+  double m2_{0.0};
+  return_t min_{std::numeric_limits<return_t>::max()};
+  return_t max_{std::numeric_limits<return_t>::min()};
+};
+
+/**
+ * @brief Parses a list of cores in the kernel's cpulist format
+ *
+ * @param  list  The list, e.g. "0-3,8,10-11"
+ * @return The cores in the order given
+ */
+inline std::vector<unsigned> parse_cpu_list(const std::string& list) {
+  auto cores = std::vector<unsigned>{};
+  auto ss    = std::istringstream{list};
+  auto item  = std::string{};
+
+  while (std::getline(ss, item, ',')) {
+    if (item.empty()) continue;
+    auto dash = item.find('-');
+
+    try {
+      if (dash == std::string::npos) {
+        cores.push_back(static_cast<unsigned>(std::stoul(item)));
+      } else {
+        auto first = std::stoul(item.substr(0, dash));
+        auto last  = std::stoul(item.substr(dash + 1));
+        if (last < first) throw std::invalid_argument(item);
+        for (auto core = first; core <= last; ++core)
+          cores.push_back(static_cast<unsigned>(core));
+      }
+    } catch (const std::exception&) {
+      throw std::logic_error("invalid core list: " + list);
+    }
+  }
+
+  return cores;
+}
+
+/**
+ * @brief Gets the physical package (socket) of a core, 0 if unknown
+ */
+inline unsigned package_of(unsigned core) {
+  auto file = std::ifstream{fmt::format(
+      "/sys/devices/system/cpu/cpu{}/topology/physical_package_id", core)};
+  auto package = 0u;
+  file >> package;
+  return file ? package : 0u;
+}
+
+/**
+ * @brief The result of a hit/miss threshold calibration
+ */
+struct calibration {
+  return_t threshold;  //! the decision threshold
+  double error_rate;   //! the balanced error rate at the threshold
+  bool hit_below;      //! are hits faster than the threshold?
+};
+
+/**
+ * @brief Finds the decision threshold minimising the balanced error rate
+ * @details The candidate thresholds are the bucket boundaries; a value is
+ *          classified as below the threshold if it lies in a lower bucket.
+ *          The direction is chosen from the means, since for some methods
+ *          (e.g. Flush+Flush) hits take longer than misses.
+ *
+ * @param  hit   The histogram of hit timings
+ * @param  miss  The histogram of miss timings, with the same bucket layout
+ */
+inline calibration calibrate(const histogram& hit, const histogram& miss) {
+  if (hit.buckets() != miss.buckets() ||
+      hit.bucket_width() != miss.bucket_width())
+    throw std::logic_error("histograms must have the same bucket layout");
+
+  auto result = calibration{0, 1.0, hit.mean() <= miss.mean()};
+  if (hit.count() == 0 || miss.count() == 0) return result;
+
+  auto hits   = static_cast<double>(hit.count());
+  auto misses = static_cast<double>(miss.count());
+  auto below_hits   = 0.0;
+  auto below_misses = 0.0;
+
+  for (auto i = 0u; i < hit.buckets(); ++i) {
+    auto error = result.hit_below
+                     ? ((hits - below_hits) / hits + below_misses / misses)
+                     : (below_hits / hits + (misses - below_misses) / misses);
+    error /= 2.0;
+
+    if (error < result.error_rate) {
+      result.error_rate = error;
+      result.threshold  = hit.bucket_lower(i);
+    }
+
+    below_hits += static_cast<double>(hit.bucket(i));
+    below_misses += static_cast<double>(miss.bucket(i));
+  }
+
+  return result;
+}
+
 }  // namespace util
 
 struct Evaluator : public exot::framework::IProcess {
@@ -203,6 +411,15 @@ struct Evaluator : public exot::framework::IProcess {
     unsigned sets{16u};
     bool measure_with_perf{true};
     bool start_immediately{true};
+    bool histogram{false};
+    unsigned bucket_width{1u};
+    unsigned bucket_count{1'024u};
+    std::string calibration_file{};
+    unsigned calibration_sets{1u};
+    std::string sweep_cores{};
+    std::string victim_cores{};
+    bool sweep_parallel{true};
+    bool batched{false};
 
     const char* name() const { return "utility"; }
 
@@ -226,14 +443,57 @@ struct Evaluator : public exot::framework::IProcess {
           "measure channel access with perf clock on ARM? |bool|");
       bind_and_describe_data("start_immediately", start_immediately,
                              "start collection immediately? |bool|");
+      bind_and_describe_data(
+          "histogram", histogram,
+          "output histograms instead of individual samples? |bool|");
+      bind_and_describe_data(
+          "bucket_width", bucket_width,
+          "width of histogram buckets |uint, ticks|, multiplied by the "
+          "number of sets for timings of multiple sets");
+      bind_and_describe_data(
+          "bucket_count", bucket_count,
+          "number of histogram buckets |uint|, larger values are "
+          "collected in an overflow bucket");
+      bind_and_describe_data(
+          "calibration_file", calibration_file,
+          "output file for calibrated hit/miss thresholds |str|, "
+          "e.g. \"thresholds.json\"");
+      bind_and_describe_data(
+          "calibration_sets", calibration_sets,
+          "set count whose threshold is written to the cache meter "
+          "sections |uint|, in range [1, sets]");
+      bind_and_describe_data(
+          "sweep_cores", sweep_cores,
+          "cores to sweep the measurement over |str, cpulist|, e.g. "
+          "\"0-7,16\"; enables the multi-core sweep mode");
+      bind_and_describe_data(
+          "victim_cores", victim_cores,
+          "cores running a victim thread accessing the measured line "
+          "|str, cpulist|, each paired with every swept core");
+      bind_and_describe_data(
+          "sweep_parallel", sweep_parallel,
+          "measure pairs on distinct packages concurrently? |bool|");
+      bind_and_describe_data(
+          "batched", batched,
+          "also measure amortised latencies of unrolled batches of "
+          "accesses? |bool|");
     }
   };
 
   explicit Evaluator(settings& conf)
-      : conf_{conf}, global_state_{exot::framework::GLOBAL_STATE->get()} {
+      : conf_{conf},
+        global_state_{exot::framework::GLOBAL_STATE->get()},
+        histogram_{conf_.bucket_width, conf_.bucket_count} {
     if (conf_.sets > 64)
       throw std::logic_error("conf->sets must be less than or equal 64");
 
+    if (!conf_.calibration_file.empty() &&
+        (conf_.calibration_sets < 1 || conf_.calibration_sets > conf_.sets))
+      throw std::logic_error("conf->calibration_sets must be in [1, sets]");
+
+    // individual samples are only held if they are to be output
+    if (!conf_.histogram) holder_.resize(conf_.count);
+
     // fill the arr with dummy values
     std::iota(arr.begin(), arr.end(), 0);
     // fill the ptr_arr with pointers to arr values
@@ -259,13 +519,41 @@ struct Evaluator : public exot::framework::IProcess {
       std::this_thread::sleep_for(std::chrono::milliseconds{1});
     }
 
-    application_log_->info(
-        "{}", "placeholder,method,category,class,sets,index,duration");
+    if (!conf_.sweep_cores.empty()) {
+      sweep();
+      debug_log_->info("[Evaluator] finished sweep");
+      return;
+    }
+
+    if (conf_.histogram) {
+      application_log_->info(
+          "{}", "placeholder,method,category,class,sets,bucket,lower,count");
+    } else {
+      application_log_->info(
+          "{}", "placeholder,method,category,class,sets,index,duration");
+    }
 
     measure(raw::flush, channel_access::flush_flush, "flush_flush"s);
     measure(raw::prefetch, channel_access::flush_prefetch, "flush_prefetch"s);
     measure(raw::reload, channel_access::flush_reload, "flush_reload"s);
 
+    if (conf_.batched) {
+      timer_overhead_ = calibrate_timer_overhead();
+      debug_log_->info("[Evaluator] timer overhead: {}", timer_overhead_);
+
+      measure_batched(
+          [](void_ptr_t addr) { exot::primitives::flush(addr); },
+          "flush_flush"s);
+      measure_batched(
+          [](void_ptr_t addr) { exot::primitives::prefetch(addr); },
+          "flush_prefetch"s);
+      measure_batched(
+          [](void_ptr_t addr) { exot::primitives::access_read<>(addr); },
+          "flush_reload"s);
+    }
+
+    if (!conf_.calibration_file.empty()) write_calibration();
+
     debug_log_->info("[Evaluator] finished measurements");
   }
 
@@ -282,73 +570,401 @@ struct Evaluator : public exot::framework::IProcess {
    */
   template <typename Raw, typename Operation, bool Forceful = false>
   void measure(Raw&& raw, Operation&& op, std::string&& method) {
-    static auto raw_hit_holder  = std::vector<return_t>(conf_.count);
-    static auto raw_miss_holder = std::vector<return_t>(conf_.count);
-    static auto op_hit_holder   = std::vector<return_t>(conf_.count);
-    static auto op_miss_holder  = std::vector<return_t>(conf_.count);
+    auto hit_histograms = std::vector<util::histogram>{};
 
     // raw hit
-    for (auto i = 0; i < conf_.count; ++i) {
+    collect(method, "raw", "hit", 0, [&, this]() {
       util::reload<decltype(ptr), Forceful>(ptr);
-      raw_hit_holder[i] = raw(ptr);
-    }
-
-    // dump raw hit
-    for (auto i = 0; i < conf_.count; ++i) {
-      application_log_->info("0,{},raw,hit,0,{},{}", method, i,
-                             raw_hit_holder[i]);
-    }
+      return raw(ptr);
+    });
 
     for (auto current_sets = 1; current_sets <= conf_.sets; ++current_sets) {
       // op hit
-      for (auto i = 0; i < conf_.count; ++i) {
+      collect(method, "access", "hit", current_sets, [&, this]() {
         util::reload<decltype(ptr_arr), Forceful>(ptr_arr);
-        op_hit_holder[i] = measure_duration([&, this]() {
+        return measure_duration([&, this]() {
           for (auto j = 0; j < current_sets; ++j) {
             auto dummy = op(ptr_arr[j]);
           }
         });
-      }
+      });
 
-      // dump op hit
-      for (auto i = 0; i < conf_.count; ++i) {
-        application_log_->info("0,{},access,hit,{},{},{}", method, current_sets,
-                               i, op_hit_holder[i]);
-      }
+      if (calibrating()) hit_histograms.push_back(histogram_);
     }
 
     util::flush<decltype(ptr), true>(ptr);
     util::flush<decltype(ptr_arr), true>(ptr_arr);
 
     // raw miss
-    for (auto i = 0; i < conf_.count; ++i) {
+    collect(method, "raw", "miss", 0, [&, this]() {
       util::flush<decltype(ptr), Forceful>(ptr);
-      raw_miss_holder[i] = raw(ptr);
-    }
-
-    // dump raw miss
-    for (auto i = 0; i < conf_.count; ++i) {
-      application_log_->info("0,{},raw,miss,0,{},{}", method, i,
-                             raw_miss_holder[i]);
-    }
+      return raw(ptr);
+    });
 
     for (auto current_sets = 1; current_sets <= conf_.sets; ++current_sets) {
       // op miss
-      for (auto i = 0; i < conf_.count; ++i) {
+      collect(method, "access", "miss", current_sets, [&, this]() {
         util::flush<decltype(ptr_arr), Forceful>(ptr_arr);
-        op_miss_holder[i] = measure_duration([&, this]() {
+        return measure_duration([&, this]() {
           for (auto j = 0; j < current_sets; ++j) {
             auto dummy = op(ptr_arr[j]);
           }
         });
+      });
+
+      if (calibrating()) {
+        auto result =
+            util::calibrate(hit_histograms.at(current_sets - 1), histogram_);
+        debug_log_->info(
+            "[Evaluator] {} threshold for {} sets: {} (hits {} threshold), "
+            "error rate {:.4f}",
+            method, current_sets, result.threshold,
+            result.hit_below ? "below" : "above", result.error_rate);
+        calibrations_[method].push_back(result);
       }
+    }
+  }
+
+  /**
+   * @brief Measures amortised access times of batches of raw operations
+   * @details A batch consists of N operations on distinct lines, unrolled at
+   *          compile time and timed as a single region. The calibrated timer
+   *          overhead is subtracted and the result divided by N. Since the
+   *          operations in a batch are independent, the amortised latency
+   *          also reflects memory-level parallelism. The results are reported
+   *          in the "batched" category, with the batch size in the sets
+   *          column.
+   *
+   * @tparam Access    The untimed access function type
+   * @tparam Forceful  Use forceful reload/flush?
+   * @param  access    The untimed access function
+   * @param  method    A string identifier for reporting purposes
+   */
+  template <typename Access, bool Forceful = false>
+  void measure_batched(Access&& access, std::string&& method) {
+    measure_batches<Forceful>(access, method, batch_sizes{});
+  }
+
+  using batch_sizes = std::index_sequence<1, 4, 16, 64>;
+
+  template <bool Forceful, typename Access, std::size_t... N>
+  void measure_batches(Access& access, const std::string& method,
+                       std::index_sequence<N...>) {
+    (collect(method, "batched", "hit", static_cast<int>(N),
+             [&, this]() {
+               util::reload<decltype(ptr_arr), Forceful>(ptr_arr);
+               return amortise<N>(timed_batch<N>(access));
+             }),
+     ...);
+
+    util::flush<decltype(ptr_arr), true>(ptr_arr);
+
+    (collect(method, "batched", "miss", static_cast<int>(N),
+             [&, this]() {
+               util::flush<decltype(ptr_arr), Forceful>(ptr_arr);
+               return amortise<N>(timed_batch<N>(access));
+             }),
+     ...);
+  }
+
+  /**
+   * @brief Times N accesses to the first N lines as a single region
+   */
+  template <std::size_t N, typename Access>
+  inline __attribute__((always_inline)) return_t timed_batch(Access& access) {
+    static_assert(N >= 1 && N <= 64, "batch size must be in range [1, 64]");
+    return measure_duration([&, this]() {
+      exot::utilities::const_for<0, N>(
+          [&, this](const auto I) { access(ptr_arr[I]); });
+    });
+  }
+
+  /**
+   * @brief Subtracts the timer overhead and divides by the batch size
+   */
+  template <std::size_t N>
+  inline return_t amortise(return_t duration) const {
+    auto net = duration > timer_overhead_ ? duration - timer_overhead_ : 0;
+    return (net + N / 2) / N;
+  }
+
+  /**
+   * @brief Writes calibrated thresholds as a JSON configuration fragment
+   * @details The fragment contains a section per cache meter module with the
+   *          threshold for `calibration_sets`, which can be merged into the
+   *          meters' configuration, and the full per-set-count results.
+   */
+  void write_calibration() {
+    static const std::map<std::string, const char*> modules{
+        {"flush_flush", "cache_ff"},
+        {"flush_prefetch", "cache_fp"},
+        {"flush_reload", "cache_fr"}};
+
+    auto out = fmt::memory_buffer{};
+    auto it  = std::back_inserter(out);
+
+    fmt::format_to(it, "{{\n");
+    for (const auto& [method, results] : calibrations_) {
+      fmt::format_to(it, "  \"{}\": {{\"threshold\": {}}},\n",
+                     modules.at(method),
+                     results.at(conf_.calibration_sets - 1).threshold);
+    }
+
+    fmt::format_to(it, "  \"calibration\": {{\n");
+    for (auto m = calibrations_.begin(); m != calibrations_.end(); ++m) {
+      fmt::format_to(it, "    \"{}\": [\n", m->first);
+      for (auto i = 0u; i < m->second.size(); ++i) {
+        const auto& result = m->second[i];
+        fmt::format_to(it,
+                       "      {{\"sets\": {}, \"threshold\": {}, "
+                       "\"error_rate\": {:.6f}, \"hit_below\": {}}}{}\n",
+                       i + 1, result.threshold, result.error_rate,
+                       result.hit_below, i + 1 < m->second.size() ? "," : "");
+      }
+      fmt::format_to(it, "    ]{}\n",
+                     std::next(m) != calibrations_.end() ? "," : "");
+    }
+    fmt::format_to(it, "  }}\n}}\n");
+
+    auto* file = std::fopen(conf_.calibration_file.c_str(), "w");
+    if (file == nullptr)
+      throw std::runtime_error("failed to open " + conf_.calibration_file);
+    std::fwrite(out.data(), 1, out.size(), file);
+    std::fclose(file);
+
+    debug_log_->info("[Evaluator] wrote calibration to {}",
+                     conf_.calibration_file);
+  }
+
+  bool calibrating() const { return !conf_.calibration_file.empty(); }
+
+  /**
+   * @brief Summary statistics of a single sweep measurement
+   */
+  struct sweep_result {
+    const char* method;
+    unsigned core;
+    std::optional<unsigned> victim;
+    std::uint64_t count;
+    double mean;
+    double variance;
+    return_t min;
+    double p50;
+    double p90;
+    double p99;
+    return_t max;
+  };
+
+  using core_pair = std::pair<unsigned, std::optional<unsigned>>;
+
+  /**
+   * @brief Measures channel access latencies for pairs of cores
+   * @details Each swept core is measured on its own, and together with a
+   *          victim thread on each of the victim cores, which continuously
+   *          reads the measured line. Pairs are grouped into rounds such that
+   *          no two pairs in a round share a physical package; the pairs of a
+   *          round are measured concurrently. The results form a latency
+   *          matrix, output in long format.
+   */
+  void sweep() {
+    auto cores   = util::parse_cpu_list(conf_.sweep_cores);
+    auto victims = util::parse_cpu_list(conf_.victim_cores);
+
+    auto pairs = std::vector<core_pair>{};
+    for (auto core : cores) {
+      pairs.emplace_back(core, std::nullopt);
+      for (auto victim : victims)
+        if (victim != core) pairs.emplace_back(core, victim);
+    }
+
+    // greedily group pairs into rounds with disjoint sets of packages
+    auto rounds = std::vector<std::vector<std::size_t>>{};
+    auto rounds_packages = std::vector<std::set<unsigned>>{};
+
+    for (auto i = 0u; i < pairs.size(); ++i) {
+      auto packages = std::set<unsigned>{util::package_of(pairs[i].first)};
+      if (pairs[i].second) packages.insert(util::package_of(*pairs[i].second));
+
+      auto round = 0u;
+      for (; conf_.sweep_parallel && round < rounds.size(); ++round) {
+        if (std::none_of(packages.begin(), packages.end(), [&](auto p) {
+              return rounds_packages[round].count(p) != 0;
+            }))
+          break;
+      }
+
+      if (!conf_.sweep_parallel || round == rounds.size()) {
+        round = static_cast<unsigned>(rounds.size());
+        rounds.emplace_back();
+        rounds_packages.emplace_back();
+      }
+
+      rounds[round].push_back(i);
+      rounds_packages[round].insert(packages.begin(), packages.end());
+    }
+
+    debug_log_->info("[Evaluator] sweeping {} core pairs in {} rounds",
+                     pairs.size(), rounds.size());
+
+    // each pair writes into its own slots, one per method
+    auto results = std::vector<sweep_result>(pairs.size() * 3);
+
+    for (const auto& round : rounds) {
+      auto threads = std::vector<std::thread>{};
+      for (auto index : round) {
+        threads.emplace_back([this, &pairs, &results, index]() {
+          sweep_pair(pairs[index], &results[index * 3]);
+        });
+      }
+      for (auto& thread : threads) thread.join();
+    }
+
+    application_log_->info("{}",
+                           "placeholder,method,core,victim,count,mean,"
+                           "variance,min,p50,p90,p99,max");
+
+    for (const auto& r : results) {
+      application_log_->info(
+          "0,{},{},{},{},{:.2f},{:.2f},{},{:.1f},{:.1f},{:.1f},{}", r.method,
+          r.core, r.victim ? std::to_string(*r.victim) : ""s, r.count,
+          r.mean, r.variance, r.min, r.p50, r.p90, r.p99, r.max);
+    }
+  }
+
+  /**
+   * @brief Measures all methods for a single core pair
+   *
+   * @param  pair  The measuring core and the optional victim core
+   * @param  out   The output, room for three results
+   */
+  void sweep_pair(const core_pair& pair, sweep_result* out) {
+    exot::utilities::ThreadTraits::set_affinity(pair.first);
+    exot::utilities::ThreadTraits::set_scheduling(conf_.self_policy,
+                                                  conf_.self_priority);
+
+#if !defined(__x86_64__)
+    exot::utilities::default_timing_facility([]{});
+#endif
+
+    // every pair uses its own line, such that concurrent pairs are isolated
+    auto line = std::vector<exot::utilities::aligned_t<std::uint8_t, 64>>(1);
+    auto* address = reinterpret_cast<void_ptr_t>(line.data());
+    auto stop     = std::atomic<bool>{false};
+    auto victim   = std::thread{};
+
+    if (pair.second.has_value()) {
+      victim = std::thread([&stop, address, core = *pair.second]() {
+        exot::utilities::ThreadTraits::set_affinity(core);
+        while (!stop.load(std::memory_order_relaxed)) {
+          exot::primitives::access_read<>(address);
+        }
+      });
+    }
+
+    auto hist = util::histogram{conf_.bucket_width, conf_.bucket_count};
+    auto run  = [&, this](auto&& op, const char* method, sweep_result& r) {
+      hist.reset();
+      for (auto i = 0; i < conf_.count; ++i) { hist.add(op(address)); }
+      warn_overflow(hist, fmt::format("{} on core {}", method, pair.first));
+      r = {method,
+           pair.first,
+           pair.second,
+           hist.count(),
+           hist.mean(),
+           hist.variance(),
+           hist.min(),
+           hist.percentile(0.5),
+           hist.percentile(0.9),
+           hist.percentile(0.99),
+           hist.max()};
+    };
+
+    run(channel_access::flush_flush, "flush_flush", out[0]);
+    run(channel_access::flush_prefetch, "flush_prefetch", out[1]);
+    run(channel_access::flush_reload, "flush_reload", out[2]);
+
+    stop.store(true, std::memory_order_relaxed);
+    if (victim.joinable()) victim.join();
+  }
+
+  /**
+   * @brief Takes `count` samples and outputs them or their histogram
+   * @details Samples are only output after all have been taken, such that
+   *          logging does not interfere with the measurement. The histogram
+   *          is also built in sample mode when thresholds are calibrated.
+   *
+   * @param  method    The method identifier
+   * @param  category  The category identifier ("raw" or "access")
+   * @param  cls       The class identifier ("hit" or "miss")
+   * @param  sets      The number of accessed sets
+   * @param  sample    The callable producing a single sample
+   */
+  template <typename Sampler>
+  void collect(const std::string& method, const char* category,
+               const char* cls, int sets, Sampler&& sample) {
+    if (!conf_.histogram) {
+      for (auto i = 0; i < conf_.count; ++i) { holder_[i] = sample(); }
 
-      // dump op miss
       for (auto i = 0; i < conf_.count; ++i) {
-        application_log_->info("0,{},access,miss,{},{},{}", method,
-                               current_sets, i, op_miss_holder[i]);
+        application_log_->info("0,{},{},{},{},{},{}", method, category, cls,
+                               sets, i, holder_[i]);
+      }
+
+      if (calibrating()) {
+        histogram_.reset(bucket_width(category, sets));
+        for (auto value : holder_) { histogram_.add(value); }
+        warn_overflow(histogram_, fmt::format("{},{},{},{}", method,
+                                              category, cls, sets));
       }
+      return;
     }
+
+    histogram_.reset(bucket_width(category, sets));
+    for (auto i = 0; i < conf_.count; ++i) { histogram_.add(sample()); }
+    warn_overflow(histogram_,
+                  fmt::format("{},{},{},{}", method, category, cls, sets));
+
+    for (auto i = 0u; i < histogram_.buckets(); ++i) {
+      if (histogram_.bucket(i) == 0) continue;
+      application_log_->info("0,{},{},{},{},{},{},{}", method, category, cls,
+                             sets, i, histogram_.bucket_lower(i),
+                             histogram_.bucket(i));
+    }
+
+    debug_log_->info(
+        "[Evaluator] {},{},{},{}: n={}, mean={:.2f}, var={:.2f}, min={}, "
+        "p50={:.1f}, p90={:.1f}, p99={:.1f}, p99.9={:.1f}, max={}, "
+        "overflow={}",
+        method, category, cls, sets, histogram_.count(), histogram_.mean(),
+        histogram_.variance(), histogram_.min(), histogram_.percentile(0.5),
+        histogram_.percentile(0.9), histogram_.percentile(0.99),
+        histogram_.percentile(0.999), histogram_.max(),
+        histogram_.bucket(histogram_.buckets() - 1));
+  }
+
+  /**
+   * @brief Gets the bucket width for a measurement
+   * @details Timings of accesses to multiple sets grow with their number,
+   *          so the width is scaled by it to keep them within the range of
+   *          the buckets. Batched timings are amortised and not scaled.
+   */
+  return_t bucket_width(const char* category, int sets) const {
+    auto scale = std::string{category} == "access" && sets > 1 ? sets : 1;
+    return static_cast<return_t>(conf_.bucket_width) *
+           static_cast<return_t>(scale);
+  }
+
+  /**
+   * @brief Warns if more than 1% of the samples of a histogram overflow,
+   *        which makes its percentiles and calibrated thresholds unreliable
+   */
+  void warn_overflow(const util::histogram& hist, const std::string& label) {
+    if (hist.overflow_fraction() <= 0.01) return;
+    debug_log_->warn(
+        "[Evaluator] {}: {:.1f}% of samples exceed the last bucket at {} "
+        "ticks, increase bucket_width or bucket_count",
+        label, 100.0 * hist.overflow_fraction(),
+        hist.bucket_lower(hist.buckets() - 1));
   }
 
   template <typename Callable, typename... Args>
@@ -372,6 +988,18 @@ struct Evaluator : public exot::framework::IProcess {
 #endif
   }
 
+  /**
+   * @brief Estimates the overhead of the timing facility
+   * @return The median duration of an empty timed region
+   */
+  return_t calibrate_timer_overhead() {
+    auto samples = std::vector<return_t>(std::max(conf_.count, 1'000u));
+    for (auto& sample : samples) { sample = measure_duration([]() {}); }
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2,
+                     samples.end());
+    return samples[samples.size() / 2];
+  }
+
  private:
   using state_type     = exot::framework::State;
   using state_pointer  = std::shared_ptr<state_type>;
@@ -385,6 +1013,11 @@ struct Evaluator : public exot::framework::IProcess {
   settings conf_;
   state_pointer global_state_;
 
+  std::vector<return_t> holder_;
+  util::histogram histogram_;
+  std::map<std::string, std::vector<util::calibration>> calibrations_;
+  return_t timer_overhead_{0};
+
   logger_pointer application_log_ =
       spdlog::get("app") ? spdlog::get("app") : spdlog::stdout_color_mt("app");
   logger_pointer debug_log_ =
@@ -0,0 +1,202 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file utilities/utility_meter_decode.cpp
+ * @author     Bruno Klopott
+ * @brief      Converts binary meter outputs to CSV.
+ */
+
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <exot/apps/utilities/binary_format.h>
+#include <exot/apps/utilities/delta_encoding.h>
+
+#if defined(EXOT_APPS_HAVE_LZ4)
+#include <lz4.h>
+#endif
+
+namespace {
+
+using namespace exot::apps::utilities;
+
+using file_pointer = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+
+file_pointer open_file(const char* path, const char* mode) {
+  auto file = file_pointer{std::fopen(path, mode), &std::fclose};
+  if (!file) throw std::runtime_error(fmt::format("failed to open {}", path));
+  return file;
+}
+
+/**
+ * @brief Provides the bytes following the header, decompressing if needed
+ */
+class byte_source {
+ public:
+  byte_source(std::FILE* file, bool lz4) : file_{file}, lz4_{lz4} {
+#if !defined(EXOT_APPS_HAVE_LZ4)
+    if (lz4_) throw std::runtime_error("LZ4 support is not available");
+#endif
+  }
+
+  /**
+   * @brief Gets the next byte, or a negative value at the end of input
+   */
+  int next() {
+    if (!lz4_) return std::fgetc(file_);
+    if (position_ == block_.size() && !refill()) return -1;
+    return static_cast<unsigned char>(block_[position_++]);
+  }
+
+  /**
+   * @brief Reads a number of bytes
+   * @return False if the input ended before the first byte
+   */
+  bool read(char* out, std::size_t size) {
+    for (auto i = 0u; i < size; ++i) {
+      auto byte = next();
+      if (byte < 0) {
+        if (i == 0) return false;
+        throw std::runtime_error("truncated record");
+      }
+      out[i] = static_cast<char>(byte);
+    }
+    return true;
+  }
+
+ private:
+  bool refill() {
+#if defined(EXOT_APPS_HAVE_LZ4)
+    std::uint32_t sizes[2];
+    if (std::fread(sizes, sizeof(sizes), 1, file_) != 1) return false;
+
+    compressed_.resize(sizes[1]);
+    block_.resize(sizes[0]);
+    if (std::fread(compressed_.data(), compressed_.size(), 1, file_) != 1)
+      throw std::runtime_error("truncated compressed block");
+
+    auto decoded = LZ4_decompress_safe(
+        compressed_.data(), block_.data(), static_cast<int>(sizes[1]),
+        static_cast<int>(sizes[0]));
+    if (decoded != static_cast<int>(sizes[0]))
+      throw std::runtime_error("corrupted compressed block");
+
+    position_ = 0;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  std::FILE* file_;
+  bool lz4_;
+  std::vector<char> block_;
+  std::vector<char> compressed_;
+  std::size_t position_{0};
+};
+
+void decode(std::FILE* in, std::FILE* out) {
+  auto layout = read_header(in);
+
+  if (layout.encoding != record_encoding::raw &&
+      layout.encoding != record_encoding::delta)
+    throw std::runtime_error(
+        fmt::format("unsupported record encoding {}",
+                    static_cast<unsigned>(layout.encoding)));
+
+  auto source  = byte_source{in, (layout.flags & lz4_blocks) != 0};
+  auto decoder = delta_decoder{layout};
+  auto next_record = [&](char* record) {
+    if (layout.encoding == record_encoding::delta)
+      return decoder.decode([&source]() { return source.next(); }, record);
+    return source.read(record, layout.record_size());
+  };
+
+  auto line = fmt::memory_buffer{};
+
+  fmt::format_to(std::back_inserter(line), "timestamp");
+  for (const auto& channel : layout.channels)
+    fmt::format_to(std::back_inserter(line), ",{}", channel.name);
+  line.push_back('\n');
+  std::fwrite(line.data(), 1, line.size(), out);
+
+  auto record = std::vector<char>(layout.record_size());
+
+  while (next_record(record.data())) {
+    line.clear();
+
+    const auto* source = record.data();
+    unpack_value(source, channel_type::i64, [&line](auto value) {
+      fmt::format_to(std::back_inserter(line), "{}", value);
+    });
+
+    for (const auto& channel : layout.channels) {
+      unpack_value(source, channel.type, [&line](auto value) {
+        // print 8-bit values as numbers rather than characters
+        if constexpr (sizeof(value) == 1) {
+          fmt::format_to(std::back_inserter(line), ",{}", +value);
+        } else {
+          fmt::format_to(std::back_inserter(line), ",{}", value);
+        }
+      });
+    }
+
+    line.push_back('\n');
+    std::fwrite(line.data(), 1, line.size(), out);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    fmt::print(::stderr, "Usage: {} <input> [output.csv]\n", argv[0]);
+    return 1;
+  }
+
+  try {
+    auto in = open_file(argv[1], "rb");
+    if (argc == 3) {
+      auto out = open_file(argv[2], "wb");
+      decode(in.get(), out.get());
+    } else {
+      decode(in.get(), stdout);
+    }
+  } catch (const std::exception& e) {
+    fmt::print(::stderr, "Error: {}\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
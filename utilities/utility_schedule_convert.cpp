@@ -0,0 +1,158 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file utilities/utility_schedule_convert.cpp
+ * @author     Bruno Klopott
+ * @brief      Converts text schedules to the binary schedule format, and
+ *             binary schedules back to text.
+ *
+ * Subtokens are decimal numbers, hexadecimal ones with "--hex", or strings
+ * of bits with "--bitset", as read by generators with std::bitset
+ * subtokens, e.g. "1010" for the bits 3 and 1.
+ */
+
+#include <bitset>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <exot/apps/utilities/schedule_file.h>
+
+namespace {
+
+using namespace exot::apps::utilities;
+
+using file_pointer = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+
+file_pointer open_file(const char* path, const char* mode) {
+  auto file = file_pointer{std::fopen(path, mode), &std::fclose};
+  if (!file) throw std::runtime_error(fmt::format("failed to open {}", path));
+  return file;
+}
+
+void write_fully(std::FILE* out, const void* data, std::size_t size) {
+  if (std::fwrite(data, 1, size, out) != size)
+    throw std::runtime_error("failed to write the output");
+}
+
+/**
+ * @brief Converts a text schedule to a binary schedule
+ */
+std::size_t encode(const char* input, std::FILE* out, double unit, bool hex,
+                   bool bitset) {
+  std::ifstream file{input};
+  if (!file) throw std::runtime_error(fmt::format("failed to open {}", input));
+
+  std::vector<schedule_record> records;
+  std::string line;
+  while (std::getline(file, line)) {
+    auto record = bitset ? parse_schedule_line<std::bitset<64>>(line, unit)
+                         : parse_schedule_line(line, unit, hex);
+    if (record) records.push_back(*record);
+  }
+
+  schedule_header header{};
+  std::memcpy(header.magic, schedule_magic, sizeof(schedule_magic));
+  header.version = schedule_version;
+  header.count   = records.size();
+
+  write_fully(out, &header, sizeof(header));
+  write_fully(out, records.data(), records.size() * sizeof(schedule_record));
+  return records.size();
+}
+
+/**
+ * @brief Converts a binary schedule to a text schedule
+ */
+std::size_t decode(const char* input, std::FILE* out, double unit, bool hex,
+                   bool bitset) {
+  schedule_view view{input};
+  for (std::size_t i = 0; i < view.size(); ++i) {
+    auto duration = static_cast<double>(view[i].duration) / unit;
+    auto line =
+        bitset ? fmt::format("{},{:b}\n", duration, view[i].payload)
+               : hex ? fmt::format("{},{:x}\n", duration, view[i].payload)
+                     : fmt::format("{},{}\n", duration, view[i].payload);
+    write_fully(out, line.data(), line.size());
+  }
+
+  return view.size();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<const char*> paths;
+  auto unit = std::string{"ns"};
+  auto hex    = false;
+  auto bitset = false;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--hex") == 0) {
+      hex = true;
+    } else if (std::strcmp(argv[i], "--bitset") == 0) {
+      bitset = true;
+    } else if (std::strcmp(argv[i], "--unit") == 0 && i + 1 < argc) {
+      unit = argv[++i];
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+
+  if (paths.size() != 2 || (hex && bitset)) {
+    fmt::print(::stderr,
+               "Usage: {} <input> <output> [--unit ns|us|ms|s] "
+               "[--hex | --bitset]\n"
+               "Text inputs are converted to binary schedules, binary inputs "
+               "back to text.\n",
+               argv[0]);
+    return 1;
+  }
+
+  try {
+    auto scale = schedule_unit(unit);
+    auto out   = open_file(paths[1], "wb");
+    auto count = is_binary_schedule(paths[0])
+                     ? decode(paths[0], out.get(), scale, hex, bitset)
+                     : encode(paths[0], out.get(), scale, hex, bitset);
+    fmt::print(::stderr, "Converted {} tokens\n", count);
+  } catch (const std::exception& e) {
+    fmt::print(::stderr, "Error: {}\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,176 @@
+// Copyright (c) 2015-2020, Swiss Federal Institute of Technology (ETH Zurich)
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+/**
+ * @file utilities/utility_sysfs_bench.cpp
+ * @author     Bruno Klopott
+ * @brief      Measures the per-sample cost of reading sets of sysfs
+ *             attributes with open/read/close, pread, and io_uring.
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <exot/apps/utilities/deadline.h>
+#include <exot/apps/utilities/sysfs_batch.h>
+
+namespace {
+
+using namespace exot::apps::utilities;
+
+/**
+ * @brief Lists the per-core frequency and the thermal zone attributes
+ * @details Falls back to the per-core topology attributes on hosts without
+ *          cpufreq and thermal zones, e.g. virtual machines.
+ */
+std::vector<std::string> default_paths() {
+  std::vector<std::string> paths;
+  for (auto cpu : list_numbered_entries("/sys/devices/system/cpu", "cpu")) {
+    auto path = fmt::format(
+        "/sys/devices/system/cpu/cpu{}/cpufreq/scaling_cur_freq", cpu);
+    if (::access(path.c_str(), R_OK) == 0) paths.push_back(path);
+  }
+  for (auto zone : list_numbered_entries("/sys/class/thermal", "thermal_zone"))
+    paths.push_back(
+        fmt::format("/sys/class/thermal/thermal_zone{}/temp", zone));
+
+  if (paths.empty()) {
+    fmt::print(::stderr,
+               "No cpufreq or thermal attributes, using topology/core_id\n");
+    for (auto cpu : list_numbered_entries("/sys/devices/system/cpu", "cpu"))
+      paths.push_back(fmt::format(
+          "/sys/devices/system/cpu/cpu{}/topology/core_id", cpu));
+  }
+
+  return paths;
+}
+
+/**
+ * @brief Times a number of samples and prints the per-sample cost
+ */
+template <typename Sample>
+void run(const char* name, std::size_t samples, double syscalls,
+         Sample&& sample) {
+  std::vector<std::int64_t> costs(samples);
+  for (auto& cost : costs) {
+    auto start = monotonic_ns();
+    sample();
+    cost = monotonic_ns() - start;
+  }
+
+  std::sort(costs.begin(), costs.end());
+  auto mean = 0.0;
+  for (auto cost : costs) mean += static_cast<double>(cost);
+  mean /= static_cast<double>(samples);
+
+  fmt::print("{:>16} {:>12.2f} {:>12.2f} {:>12.2f} {:>10.0f}\n", name,
+             mean / 1e3, costs[samples / 2] / 1e3,
+             costs[std::min(samples - 1, samples * 99 / 100)] / 1e3,
+             syscalls);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::size_t samples = 1000;
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      samples = std::stoul(argv[++i]);
+    } else if (std::strcmp(argv[i], "--help") == 0) {
+      fmt::print(::stderr,
+                 "Usage: {} [--samples N] [attribute...]\n"
+                 "Attributes default to the per-core cpufreq and the thermal "
+                 "zone files.\n",
+                 argv[0]);
+      return 1;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+
+  if (paths.empty()) paths = default_paths();
+  if (paths.empty() || samples == 0) {
+    fmt::print(::stderr, "Nothing to measure\n");
+    return 1;
+  }
+
+  try {
+    auto count  = static_cast<double>(paths.size());
+    auto values = std::vector<sysfs_batch::value_type>{};
+    auto sink   = std::int64_t{0};
+
+    fmt::print("{} attributes, {} samples\n", paths.size(), samples);
+    fmt::print("{:>16} {:>12} {:>12} {:>12} {:>10}\n", "method", "mean [us]",
+               "p50 [us]", "p99 [us]", "syscalls");
+
+    run("open/read/close", samples, 4 * count, [&] {
+      for (const auto& path : paths) {
+        std::ifstream file{path};
+        std::int64_t value{0};
+        file >> value;
+        sink += value;
+      }
+    });
+
+    sysfs_batch pread{paths, sysfs_backend::pread};
+    run("pread", samples, count, [&] {
+      pread.read(values);
+      sink += values[0].value_or(0);
+    });
+
+    sysfs_batch ring{paths, sysfs_backend::io_uring};
+    if (ring.backend() == sysfs_backend::io_uring) {
+      run("io_uring", samples, std::ceil(count / 256), [&] {
+        ring.read(values);
+        sink += values[0].value_or(0);
+      });
+    } else {
+      fmt::print("{:>16} unavailable\n", "io_uring");
+    }
+
+    fmt::print(::stderr, "checksum: {}\n", sink);
+  } catch (const std::exception& e) {
+    fmt::print(::stderr, "Error: {}\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}